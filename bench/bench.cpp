@@ -0,0 +1,344 @@
+// Measures the speed and the allocations of every stage of the simulator separately, on generated programs of
+// growing size. Prints a JSON object per line, so that the results of different commits can be compared.
+
+#include "mappedparser.h"
+#include "renderer.h"
+#include "translator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+static atomic<size_t> allocBytes = 0;
+static atomic<size_t> allocCnt = 0;
+
+void *operator new(size_t size)
+{
+	allocBytes.fetch_add(size, memory_order_relaxed);
+	allocCnt.fetch_add(1, memory_order_relaxed);
+
+	if (void *ptr = malloc(size > 0 ? size : 1)) return ptr;
+	throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+// Stream buffer that discards everything, so that printing is measured without the cost of the terminal or disk.
+class nullBuffer : public streambuf
+{
+	char buffer[4096];
+
+  protected:
+	int overflow(int c) override
+	{
+		setp(buffer, buffer + sizeof(buffer));
+		return c;
+	}
+};
+
+class measurement
+{
+  public:
+	double seconds = 0;
+	size_t bytes = 0;
+	size_t allocs = 0;
+};
+
+// Measures the time and the allocations between its creation and the call to stop.
+class timer
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	size_t startBytes = allocBytes;
+	size_t startAllocs = allocCnt;
+
+  public:
+	measurement stop()
+	{
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		return {.seconds = seconds, .bytes = allocBytes - startBytes, .allocs = allocCnt - startAllocs};
+	}
+};
+
+// Keeps the fastest of several repetitions, which is the least affected by noise.
+static void keepBest(measurement &best, const measurement &m)
+{
+	if (best.seconds == 0 || m.seconds < best.seconds) best = m;
+}
+
+static void report(const string &stage, uint staticCnt, uint dynamicCnt, const measurement &m)
+{
+	uint instrCnt = dynamicCnt > 0 ? dynamicCnt : staticCnt;
+
+	cout << "{\"stage\": \"" << stage << "\", \"static_instructions\": " << staticCnt
+		 << ", \"dynamic_instructions\": " << dynamicCnt << ", \"seconds\": " << m.seconds
+		 << ", \"instructions_per_second\": " << (m.seconds > 0 ? (uint64_t)(instrCnt / m.seconds) : 0)
+		 << ", \"bytes_allocated\": " << m.bytes << ", \"allocations\": " << m.allocs << "}" << endl;
+}
+
+// Labels can only have letters.
+static string labelName(uint n)
+{
+	string name = "L";
+
+	do {
+		name += 'A' + n % 26;
+		n /= 26;
+	} while (n > 0);
+
+	return name;
+}
+
+// Straight-line program with variables, every kind of instruction and labeled forward branches.
+static string staticSource(uint size)
+{
+	ostringstream src;
+	src << "DEFW $20, 7\nDEVW $21, 64\n";
+
+	for (uint i = 0; i < size; i++) {
+		if (i % 16 == 15) src << labelName(i) << ": ";
+
+		switch (i % 8) {
+			case 0:
+				src << "ADD $1, $2, $3\n";
+				break;
+			case 1:
+				src << "ADDI $2, $1, 12\n";
+				break;
+			case 2:
+				src << "LW $3, 4($21)\n";
+				break;
+			case 3:
+				src << "SUB $4, $3, $1\n";
+				break;
+			case 4:
+				src << "SW $4, 8($21)\n";
+				break;
+			case 5:
+				src << "XORI $5, $4, 255\n";
+				break;
+			case 6:
+				src << "OR $6, $5, $2\n";
+				break;
+			default: {
+				// Branches to the next label, if there is one. A branch can't use its own label.
+				uint target = i % 16 == 15 ? i + 16 : i | 15;
+
+				if (target < size)
+					src << "BEQ $6, $0, " << labelName(target) << "\n";
+				else
+					src << "NOP\n";
+			}
+		}
+	}
+
+	return src.str();
+}
+
+// Two nested loops around a body with loads, stores and dependencies, executing about dynamicCnt instructions.
+static string loopSource(uint dynamicCnt)
+{
+	uint inner = clamp(dynamicCnt / 10, 1u, 30000u);
+	uint outer = clamp(dynamicCnt / (inner * 10), 1u, 30000u);
+
+	ostringstream src;
+	src << "DEVW $21, 64\n"
+		<< "ADDI $10, $0, " << outer << "\n"
+		<< "OUTER: ADDI $9, $0, " << inner << "\n"
+		<< "INNER: ADD $1, $1, $9\n"
+		<< "LW $2, 0($21)\n"
+		<< "ADDI $2, $2, 1\n"
+		<< "SW $2, 0($21)\n"
+		<< "XOR $3, $1, $2\n"
+		<< "SUB $4, $3, $1\n"
+		<< "AND $5, $4, $2\n"
+		<< "OR $6, $5, $3\n"
+		<< "ADDI $9, $9, -1\n"
+		<< "BNE $9, $0, INNER\n"
+		<< "ADDI $10, $10, -1\n"
+		<< "BNE $10, $0, OUTER\n";
+
+	return src.str();
+}
+
+static bool load(const string &src, simulator::program &prog)
+{
+	istringstream in(src);
+	if (translator::loadProgram(in, prog, cerr)) return true;
+
+	cerr << "Error: The generated program is not correct." << endl;
+	return false;
+}
+
+static bool benchFrontEnd(uint size, uint repeats)
+{
+	string src = staticSource(size);
+	measurement parseBest, mappedBest, translateBest;
+
+	for (uint r = 0; r < repeats; r++) {
+		istringstream in(src);
+
+		timer parseTimer;
+		vector<parser::instruction> instrs = parser::parse(&in, &cerr);
+		keepBest(parseBest, parseTimer.stop());
+
+		simulator::program prog;
+		timer translateTimer;
+		bool correct = translator::translateProgram(instrs, prog, cerr);
+		keepBest(translateBest, translateTimer.stop());
+
+		parser::freeResources();
+
+		if (!correct) {
+			cerr << "Error: The generated program is not correct." << endl;
+			return false;
+		}
+
+		// The source is already in memory, so mapping the file is not measured.
+		parser::mappedParser mappedParser;
+		timer mappedTimer;
+		mappedParser.parse(src, cerr);
+		keepBest(mappedBest, mappedTimer.stop());
+	}
+
+	report("parse", size, 0, parseBest);
+	report("parse-mmap", size, 0, mappedBest);
+	report("translate", size, 0, translateBest);
+	return true;
+}
+
+static bool benchExecute(uint dynamicCnt, uint repeats)
+{
+	simulator::program loaded;
+	if (!load(loopSource(dynamicCnt), loaded)) return false;
+
+	static const pair<const char *, simulator::dispatchType> dispatches[] = {
+		{"execute-switch", simulator::dispatchType::SWITCH},
+		{"execute-threaded", simulator::dispatchType::THREADED},
+		{"execute-block", simulator::dispatchType::BLOCK}};
+
+	for (auto [stage, dispatch] : dispatches) {
+		measurement best;
+		uint executed = 0;
+
+		for (uint r = 0; r < repeats; r++) {
+			simulator::program prog = loaded;
+			executed = 0;
+
+			timer t;
+			simulator::interpreter interpreter(prog.code, prog.dataMem, prog.regs, dispatch);
+			simulator::pipeline pipeline(prog.code, interpreter, simulator::forwardingType::FULL,
+										 simulator::branchPredType::NOT_TAKEN, false);
+
+			while (pipeline.step()) {
+				if (pipeline.executing() != nullptr) executed++;
+			}
+
+			keepBest(best, t.stop());
+		}
+
+		report(stage, loaded.code.size(), executed, best);
+	}
+
+	return true;
+}
+
+static bool benchRender(uint dynamicCnt, uint repeats)
+{
+	simulator::program prog;
+	if (!load(loopSource(dynamicCnt), prog)) return false;
+
+	// The timing is simulated beforehand, so that only printing is measured.
+	vector<simulator::timing> rows;
+	simulator::interpreter interpreter(prog.code, prog.dataMem, prog.regs, simulator::dispatchType::SWITCH);
+	simulator::pipeline pipeline(prog.code, interpreter, simulator::forwardingType::FULL,
+								 simulator::branchPredType::NOT_TAKEN, false);
+
+	while (pipeline.step()) {
+		if (const simulator::timing *executing = pipeline.executing()) rows.push_back(*executing);
+	}
+
+	nullBuffer buffer;
+	ostream out(&buffer);
+	measurement best;
+
+	for (uint r = 0; r < repeats; r++) {
+		timer t;
+		renderer::diagram diagram(out, prog.codeText, false, false, false, false, simulator::forwardingType::FULL);
+
+		for (simulator::timing &row : rows)
+			diagram.addInstr(row);
+
+		diagram.finish();
+		keepBest(best, t.stop());
+	}
+
+	report("render", prog.code.size(), rows.size(), best);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint repeats = 3;
+	uint maxSize = 1000000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "hr:m:")) != -1) {
+		switch (opt) {
+			case 'r': {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 6 ||
+					stoul(arg) == 0) {
+					cerr << "Error: Invalid amount of repeats " << arg << endl;
+					return -1;
+				}
+
+				repeats = stoul(arg);
+				break;
+			}
+
+			case 'm': {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 9) {
+					cerr << "Error: Invalid amount of instructions " << arg << endl;
+					return -1;
+				}
+
+				maxSize = max(stoul(arg), 1000ul);
+				break;
+			}
+
+			default:
+				cout << "MIPS Pipeline Simulator Benchmark Options\n"
+						"\t-r [n]\tRepeat every measurement n times and keep the fastest one. 3 by default.\n"
+						"\t-m [n]\tMaximum amount of instructions of the programs. 1000000 by default.\n"
+						"\nThe sizes grow by 10 times from 1000. Printing the diagram grows quadratically, so it "
+						"only goes up to 2% of the maximum."
+					 << endl;
+				return opt == 'h' ? 0 : -1;
+		}
+	}
+
+	for (uint size = 1000; size <= maxSize; size *= 10) {
+		if (!benchFrontEnd(size, repeats)) return -1;
+	}
+
+	for (uint size = 1000; size <= maxSize; size *= 10) {
+		if (!benchExecute(size, repeats)) return -1;
+	}
+
+	for (uint size = 1000; size <= maxSize / 50; size *= 2) {
+		if (!benchRender(size, repeats)) return -1;
+	}
+}
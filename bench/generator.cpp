@@ -0,0 +1,328 @@
+// Generates synthetic programs to stress the parser and the simulator. The same options and seed always produce
+// the same program.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Registers used for each purpose. Results rotate between the value registers, so that the register written a
+// given amount of instructions ago is known, as long as the amount is lower than valueRegs.
+static const int valueRegs = 15; // $1 to $15
+static const int firstCounterReg = 16; // $16 to $19, one per loop level
+static const int maxLoops = 4;
+static const int firstBaseReg = 20; // $20 to $27, one per window of memory
+static const int maxWindows = 8;
+static const int windowSize = 32764; // Largest offset that fits in an immediate, aligned to words
+
+class settings
+{
+  public:
+	uint size = 1000; // Approximate amount of static instructions.
+	uint loops = 1; // Nesting depth of every loop.
+	uint iterations = 10; // Iterations of every loop.
+	uint body = 16; // Instructions inside the innermost loop.
+	vector<double> distances = {1, 1, 1, 1}; // Weight of every dependency distance, starting from 1.
+	double branches = 0.1; // Ratio of forward branches in the body.
+	double taken = 0.5; // Ratio of forward branches that are taken.
+	uint memory = 1024; // Bytes of memory used by loads and stores.
+	uint seed = 1;
+};
+
+class generator
+{
+	const settings &set;
+	ostream &out;
+	mt19937 rng;
+
+	uint emitted = 0;
+	uint labels = 0;
+	uint nextValue = 0; // Next value register to write.
+	uint windows;
+
+	// Own distributions, since the standard ones may give different results in every library.
+	uint below(uint n)
+	{
+		return rng() % n;
+	}
+
+	double ratio()
+	{
+		return rng() / 4294967296.0;
+	}
+
+	// Labels can only have letters.
+	string newLabel()
+	{
+		string name = "L";
+
+		for (uint n = labels++; n > 0 || name.length() == 1; n /= 26)
+			name += 'A' + n % 26;
+
+		return name;
+	}
+
+	int newValueReg()
+	{
+		int r = 1 + nextValue % valueRegs;
+		nextValue++;
+		return r;
+	}
+
+	// Register written a random distance ago, following the distribution of distances.
+	int sourceReg()
+	{
+		double total = 0;
+		for (double weight : set.distances)
+			total += weight;
+
+		double pick = ratio() * total;
+		uint dist = 1;
+
+		for (; dist < set.distances.size(); dist++) {
+			pick -= set.distances[dist - 1];
+			if (pick < 0) break;
+		}
+
+		if (nextValue < dist) return 1 + below(valueRegs);
+		return 1 + (nextValue - dist) % valueRegs;
+	}
+
+	string memOperand(uint size)
+	{
+		uint window = below(windows);
+		uint bytes = min(set.memory - window * windowSize, (uint)windowSize);
+		uint offset = below(max(bytes / size, 1u)) * size;
+
+		return to_string(offset) + "($" + to_string(firstBaseReg + window) + ")";
+	}
+
+	// A single instruction, without any label.
+	string instruction()
+	{
+		static const char *r3[] = {"ADD", "ADDU", "SUB", "SUBU", "AND", "OR", "NOR", "XOR"};
+		static const char *r2[] = {"ADDI", "ADDIU", "ANDI", "ORI", "XORI"};
+
+		uint kind = below(100);
+
+		if (kind < 40) {
+			int rS = sourceReg(), rT = sourceReg();
+			return string(r3[below(8)]) + " $" + to_string(newValueReg()) + ", $" + to_string(rS) + ", $" +
+				   to_string(rT);
+		}
+
+		if (kind < 70) {
+			int rS = sourceReg();
+			return string(r2[below(5)]) + " $" + to_string(newValueReg()) + ", $" + to_string(rS) + ", " +
+				   to_string((int)below(200) - 100);
+		}
+
+		if (kind < 85) {
+			bool word = below(4) > 0;
+			return string(word ? "LW" : "LB") + " $" + to_string(newValueReg()) + ", " + memOperand(word ? 4 : 1);
+		}
+
+		bool word = below(4) > 0;
+		return string(word ? "SW" : "SB") + " $" + to_string(sourceReg()) + ", " + memOperand(word ? 4 : 1);
+	}
+
+	void emit(const string &label, const string &instr)
+	{
+		if (!label.empty()) out << label << ": ";
+		out << instr << '\n';
+		emitted++;
+	}
+
+	// Straight-line code with forward branches that skip up to 3 instructions. Whether they are taken doesn't depend
+	// on the data, so that the ratio is exact.
+	void emitBody(uint count)
+	{
+		vector<string> pending(count + 1); // Label each instruction needs, if any.
+
+		for (uint i = 0; i < count; i++) {
+			string label = pending[i];
+
+			if (i + 1 < count && ratio() < set.branches) {
+				uint target = min(i + 2 + below(3), count);
+				if (pending[target].empty()) pending[target] = newLabel();
+
+				bool taken = ratio() < set.taken;
+				emit(label, string(taken ? "BEQ" : "BNE") + " $0, $0, " + pending[target]);
+			} else {
+				emit(label, instruction());
+			}
+		}
+
+		// Branches that skip to the end need an instruction to land on.
+		if (!pending[count].empty()) emit(pending[count], "NOP");
+	}
+
+	void emitLoop(uint level)
+	{
+		if (level == set.loops) {
+			emitBody(set.body);
+			return;
+		}
+
+		int counter = firstCounterReg + level;
+		string label = newLabel();
+
+		emit("", "ADDI $" + to_string(counter) + ", $0, " + to_string(set.iterations));
+
+		// The label goes on the first instruction of the loop, which may be an inner loop or the body.
+		out << label << ":\t";
+		emitLoop(level + 1);
+
+		emit("", "ADDI $" + to_string(counter) + ", $" + to_string(counter) + ", -1");
+		emit("", "BNE $" + to_string(counter) + ", $0, " + label);
+	}
+
+  public:
+	generator(const settings &set, ostream &out) : set(set), out(out), rng(set.seed)
+	{
+		windows = clamp((set.memory + windowSize - 1) / windowSize, 1u, (uint)maxWindows);
+	}
+
+	void generate()
+	{
+		// A single array, with a base register every windowSize bytes.
+		out << "DEVB $" << firstBaseReg << ", " << max(set.memory, 4u) << '\n';
+
+		for (uint w = 1; w < windows; w++)
+			emit("", "ADDI $" + to_string(firstBaseReg + w) + ", $" + to_string(firstBaseReg + w - 1) + ", " +
+						 to_string(windowSize));
+
+		// Loop nests one after another until the size is reached.
+		while (emitted < set.size) {
+			if (set.loops == 0)
+				emitBody(min(set.body, set.size - emitted));
+			else
+				emitLoop(0);
+		}
+	}
+};
+
+// Parses a list of numbers separated by commas.
+static bool parseList(const string &arg, vector<double> &outRes)
+{
+	outRes.clear();
+	size_t start = 0;
+
+	while (start <= arg.length()) {
+		size_t end = arg.find(',', start);
+		if (end == string::npos) end = arg.length();
+
+		try {
+			size_t used;
+			double value = stod(arg.substr(start, end - start), &used);
+			if (used != end - start || value < 0) return false;
+			outRes.push_back(value);
+		} catch (const exception &) {
+			return false;
+		}
+
+		start = end + 1;
+	}
+
+	return !outRes.empty();
+}
+
+int main(int argc, char *argv[])
+{
+	settings set;
+	ofstream oFile;
+
+	int opt, optidx = 0;
+	static struct option long_options[] = {{"output", required_argument, nullptr, 'o'},
+										   {"size", required_argument, nullptr, 's'},
+										   {"loops", required_argument, nullptr, 'l'},
+										   {"iterations", required_argument, nullptr, 'i'},
+										   {"body", required_argument, nullptr, 'b'},
+										   {"distances", required_argument, nullptr, 'd'},
+										   {"branches", required_argument, nullptr, 'r'},
+										   {"taken", required_argument, nullptr, 't'},
+										   {"memory", required_argument, nullptr, 'm'},
+										   {"seed", required_argument, nullptr, 'x'},
+										   {"help", no_argument, nullptr, 'h'},
+										   {nullptr, 0, nullptr, 0}};
+
+	while ((opt = getopt_long(argc, argv, "ho:s:l:i:b:d:r:t:m:x:", long_options, &optidx)) != -1) {
+		switch (opt) {
+			case 'o':
+				oFile = ofstream(optarg);
+				if (!oFile.is_open()) {
+					cerr << "Error: File " << optarg << " could not be opened for writing." << endl;
+					return -1;
+				}
+
+				break;
+
+			case 's':
+				set.size = max(atoi(optarg), 1);
+				break;
+
+			case 'l':
+				set.loops = clamp(atoi(optarg), 0, maxLoops);
+				break;
+
+			case 'i':
+				set.iterations = clamp(atoi(optarg), 1, 32767);
+				break;
+
+			case 'b':
+				set.body = max(atoi(optarg), 1);
+				break;
+
+			case 'd':
+				if (!parseList(optarg, set.distances)) {
+					cerr << "Error: Invalid distances " << optarg << endl;
+					return -1;
+				}
+
+				break;
+
+			case 'r':
+				set.branches = clamp(atof(optarg), 0.0, 1.0);
+				break;
+
+			case 't':
+				set.taken = clamp(atof(optarg), 0.0, 1.0);
+				break;
+
+			case 'm':
+				set.memory = clamp(atoi(optarg), 1, maxWindows * windowSize);
+				break;
+
+			case 'x':
+				set.seed = strtoul(optarg, nullptr, 10);
+				break;
+
+			default:
+				cout << "MIPS Pipeline Workload Generator Options\n"
+						"\t-o --output [file]\tSpecify the output file to write to.\n"
+						"\t-s --size [n]\t\tApproximate amount of instructions. 1000 by default.\n"
+						"\t-l --loops [n]\t\tNesting depth of the loops, up to 4. 1 by default.\n"
+						"\t-i --iterations [n]\tIterations of every loop. 10 by default.\n"
+						"\t-b --body [n]\t\tInstructions in the innermost loops. 16 by default.\n"
+						"\t-d --distances [w1,w2,...]\tWeight of every dependency distance, starting from 1.\n"
+						"\t\t\t\tFor example, 4,1 makes 80% of the operands depend on the previous instruction.\n"
+						"\t\t\t\t1,1,1,1 by default.\n"
+						"\t-r --branches [ratio]\tRatio of forward branches in the loops. 0.1 by default.\n"
+						"\t-t --taken [ratio]\tRatio of forward branches that are taken. 0.5 by default.\n"
+						"\t-m --memory [bytes]\tMemory used by loads and stores, up to 262112. 1024 by default.\n"
+						"\t-x --seed [n]\t\tSeed of the random generator. 1 by default.\n"
+						"\nLoops, with their body, are repeated until the size is reached."
+					 << endl;
+				return opt == 'h' ? 0 : -1;
+		}
+	}
+
+	generator gen(set, oFile.is_open() ? oFile : cout);
+	gen.generate();
+}
@@ -0,0 +1,160 @@
+// Prints the records of a binary trace written with --trace as text, or only a summary of them. It is also an example
+// of how to read a trace in place: the file is mapped and the records are used without parsing them, only converting
+// their numbers to the order of the host, which does nothing on little endian ones.
+
+#include "mappedparser.h"
+#include "tracefile.h"
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+
+using renderer::traceBranch;
+using renderer::traceHeader;
+using renderer::traceKind;
+using renderer::traceRecord;
+
+static const char *stallNames[] = {"none", "data", "control", "empty", "memory"};
+
+int main(int argc, char *argv[])
+{
+	bool summaryOnly = false;
+	uint64_t first = 0;
+	uint64_t count = UINT64_MAX;
+
+	int opt, optidx = 0;
+	static struct option long_options[] = {{"summary", no_argument, nullptr, 's'},
+										   {"first", required_argument, nullptr, 'f'},
+										   {"count", required_argument, nullptr, 'n'},
+										   {"help", no_argument, nullptr, 'h'},
+										   {nullptr, 0, nullptr, 0}};
+
+	while ((opt = getopt_long(argc, argv, "hsf:n:", long_options, &optidx)) != -1) {
+		switch (opt) {
+			case 's':
+				summaryOnly = true;
+				break;
+
+			case 'f':
+				first = strtoull(optarg, nullptr, 10);
+				break;
+
+			case 'n':
+				count = strtoull(optarg, nullptr, 10);
+				break;
+
+			default:
+				cout << "MIPS Pipeline Trace Dump Options\n"
+						"\tmipspipeline_tracedump [options] <file>\n"
+						"\t-s --summary\t\tOnly print the totals of the trace.\n"
+						"\t-f --first [n]\t\tStart printing from the record n, counting from 0.\n"
+						"\t-n --count [n]\t\tPrint at most n records."
+					 << endl;
+				return opt == 'h' ? 0 : -1;
+		}
+	}
+
+	if (optind != argc - 1) {
+		cerr << "Error: A single trace file is needed." << endl;
+		return -1;
+	}
+
+	string path = argv[optind];
+	parser::mappedFile mapped;
+	if (!mapped.open(path)) {
+		cerr << "Error: File " << path << " does not exist or cannot be opened." << endl;
+		return -1;
+	}
+
+	string_view file = mapped.text();
+	traceHeader header;
+
+	if (file.size() >= sizeof(header)) {
+		memcpy(&header, file.data(), sizeof(header));
+		header.convert();
+	}
+
+	if (file.size() < sizeof(header) || memcmp(header.magic, renderer::traceMagic, sizeof(header.magic)) != 0 ||
+		header.version != renderer::traceVersion || header.recordSize != sizeof(traceRecord) ||
+		header.recordOffset < sizeof(header) || header.recordOffset > file.size()) {
+		cerr << "Error: File " << path << " is not a trace or was written by a different version." << endl;
+		return -1;
+	}
+
+	// An interrupted trace has no counts, but all of its complete records can still be read.
+	uint64_t recordCnt = header.recordCnt;
+	bool finished = header.instrCnt > 0 && header.textOffset + header.textSize <= file.size() &&
+					header.recordOffset + recordCnt * sizeof(traceRecord) <= header.textOffset;
+
+	if (!finished) recordCnt = (file.size() - header.recordOffset) / sizeof(traceRecord);
+
+	const traceRecord *records = (const traceRecord *)(file.data() + header.recordOffset);
+
+	// Texts of the instructions, only available once the trace is finished.
+	vector<string_view> texts;
+	if (finished) {
+		const char *text = file.data() + header.textOffset, *end = text + header.textSize;
+
+		while (text < end && texts.size() < header.codeCnt) {
+			texts.emplace_back(text);
+			text += texts.back().size() + 1;
+		}
+	}
+
+	auto textOf = [&texts](int32_t idx) -> string_view {
+		return idx >= 0 && (size_t)idx < texts.size() ? texts[idx] : string_view();
+	};
+
+	uint64_t instrCnt = 0, stallCnt[5] = {}, branches = 0, taken = 0, penalized = 0, loads = 0, stores = 0;
+
+	for (uint64_t i = 0; i < recordCnt; i++) {
+		traceRecord record = records[i];
+		record.convert();
+		bool print = !summaryOnly && i >= first && i - first < count;
+
+		if (record.kind == traceKind::STALL) {
+			if (record.stall < 5) stallCnt[record.stall]++;
+
+			if (print) {
+				cout << i << "\tstall\t" << (record.stall < 5 ? stallNames[record.stall] : "?") << "\tX "
+					 << record.execute << "\tcaused by " << record.idx << '\t' << textOf(record.idx) << '\n';
+			}
+
+			continue;
+		}
+
+		instrCnt++;
+		if (record.branch != traceBranch::NONE) {
+			branches++;
+			if (record.branch == traceBranch::TAKEN) taken++;
+			if (record.penalty > 0) penalized++;
+		}
+
+		if (record.kind == traceKind::LOAD) loads++;
+		if (record.kind == traceKind::STORE) stores++;
+
+		if (print) {
+			cout << i << "\tinstr\t" << record.idx << "\tF " << record.fetch << "\tD " << record.decode << "\tX "
+				 << record.execute << "\tM " << record.memory << "\tW " << record.writeback;
+
+			if (record.branch != traceBranch::NONE)
+				cout << '\t' << (record.branch == traceBranch::TAKEN ? "taken" : "not taken") << ", penalty "
+					 << (int)record.penalty;
+
+			if (record.kind == traceKind::LOAD || record.kind == traceKind::STORE)
+				cout << '\t' << (record.kind == traceKind::LOAD ? "load " : "store ") << record.address;
+
+			cout << '\t' << textOf(record.idx) << '\n';
+		}
+	}
+
+	cout << "Records: " << recordCnt << (finished ? "" : " (interrupted trace)") << "\nInstructions: " << instrCnt
+		 << "\nStalls: " << stallCnt[1] + stallCnt[2] + stallCnt[3] + stallCnt[4] << " (data " << stallCnt[1]
+		 << ", control " << stallCnt[2] << ", empty " << stallCnt[3] << ", memory " << stallCnt[4]
+		 << ")\nBranches and jumps: " << branches << " (taken " << taken << ", with penalty " << penalized
+		 << ")\nLoads: " << loads << "\nStores: " << stores;
+
+	if (finished) cout << "\nCycles: " << header.cycles;
+	cout << endl;
+
+	return 0;
+}
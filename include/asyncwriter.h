@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#if WINNT
+typedef unsigned int uint;
+#endif
+
+using namespace std;
+
+namespace parallel
+{
+// Makes a stream write through a dedicated thread while it exists. What is written is kept in large blocks, which
+// the thread writes to the original buffer of the stream one at a time, so printing only waits for the thread when
+// every block is full. Flushing hands the current block to the thread without waiting for it to be written, so what
+// was printed shows up soon. Everything is written once the writer is closed or destroyed, which also gives the
+// stream back its original buffer.
+class asyncWriter : public streambuf
+{
+	static const size_t blockSize = 1 << 20;
+	static const uint blockCnt = 4;
+
+	ostream &stream;
+	streambuf *target;
+
+	vector<unique_ptr<char[]>> blocks;
+	uint current; // Block being filled by the stream.
+
+	mutex lock;
+	condition_variable changed;
+	deque<uint> freeBlocks; // Protected by lock, as everything below.
+	deque<pair<uint, size_t>> fullBlocks; // Blocks waiting to be written and their used size.
+	bool closing = false;
+
+	atomic<bool> failed = false;
+
+	thread writer;
+
+	// Gives the used part of the current block to the thread and starts filling a free one.
+	void handOver();
+
+	void write();
+
+  protected:
+	int_type overflow(int_type ch) override;
+	int sync() override;
+
+  public:
+	asyncWriter(ostream &stream);
+	~asyncWriter();
+
+	// Writes everything left and waits until it is done. Returns false if anything could not be written.
+	bool close();
+};
+} // namespace parallel
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "simulator.h"
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+namespace simulator
+{
+enum struct replacementType : char { LRU = 0, FIFO, RANDOM };
+
+enum struct writePolicy : char {
+	BACK = 0, // Stores only write to the cache, and store misses bring the line first.
+	THROUGH // Stores go to a write buffer, which never stalls, and store misses do not bring the line.
+};
+
+// Geometry and timing of the data cache. The sizes must be powers of two.
+class cacheConfig
+{
+  public:
+	uint size = 0; // Bytes of data, 0 to complete every load and store in one memory phase.
+	uint lineSize = 32;
+	uint ways = 1;
+	replacementType replacement = replacementType::LRU;
+	writePolicy write = writePolicy::BACK;
+	uint missPenalty = 10; // Cycles the pipeline stalls on every miss.
+
+	bool operator==(const cacheConfig &other) const = default;
+};
+
+class cacheStats
+{
+  public:
+	uint64_t loads = 0;
+	uint64_t stores = 0;
+	uint64_t loadMisses = 0;
+	uint64_t storeMisses = 0;
+	uint64_t writebacks = 0; // Modified lines that had to be written to memory to make room for another one.
+};
+
+// Set-associative cache that only keeps which lines it holds, since the data itself is always in the memory of the
+// program. The lines of every set are next to each other in flat arrays, and the set of an address is found by
+// masking it, so a hit only looks at a few consecutive entries.
+class dataCache
+{
+	cacheConfig config;
+	uint lineBits;
+	uint setMask;
+
+	vector<uint> lines; // Address divided by the line size (4 or more) of the line in every way, UINT32_MAX when empty.
+	vector<uint64_t> stamps; // Last access for LRU or when the line was brought for FIFO.
+	vector<uint8_t> dirty;
+
+	uint64_t clock = 0;
+	uint32_t random = 2463534242; // Xorshift state, fixed so that every run gives the same results.
+
+	cacheStats stats;
+
+	// Way of the set to replace with a new line.
+	uint victim(uint first);
+
+  public:
+	dataCache(const cacheConfig &config);
+
+	inline bool enabled() const
+	{
+		return config.size > 0;
+	}
+
+	// Accesses the line of the address. Returns the cycles it stalls the pipeline, 0 if it hit.
+	uint access(uint address, bool store);
+
+	const cacheStats &getStats() const;
+
+	// Writes the lines it holds, the replacement state and the statistics. The size only depends on the
+	// configuration.
+	void save(ostream &out) const;
+
+	// Restores what save wrote for the same configuration, removing it from the start of the data. Returns false if
+	// the data is too short.
+	bool load(string_view &data);
+};
+} // namespace simulator
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "renderer.h"
+#include "runner.h"
+#include <cstdint>
+
+namespace runner
+{
+// State of a simulation between two cycles, apart from the memory, which is saved after it.
+class checkpoint
+{
+  public:
+	// Checked when restoring, since the state is only valid for the same program and pipeline options.
+	uint64_t codeHash;
+	uint codeCnt;
+	simulator::forwardingType forwarding;
+	simulator::branchPredType branchPred;
+	bool branchInDec;
+	simulator::predictorConfig predictor;
+	simulator::cacheConfig cache;
+
+	int regs[32];
+	simulator::pipelineState pipeline;
+	renderer::diagramState diagram;
+	uint instrCnt;
+	uint cycles;
+};
+
+static_assert(is_trivially_copyable_v<checkpoint>);
+
+// Returns the state of a running simulation of the program.
+checkpoint makeCheckpoint(const simulator::program &prog, const settings &set, const simulator::pipeline &pipeline,
+						  const renderer::diagram &diagram, const result &res);
+
+// Writes the checkpoint, the memory of the program and the tables of the pipeline to a file. The previous file is
+// only replaced once the new one is complete, so an interrupted run always leaves a valid checkpoint. Returns false
+// if it cannot be written and prints an error to the stream.
+bool saveCheckpoint(const string &path, const checkpoint &state, const simulator::program &prog,
+					const simulator::pipeline &pipeline, ostream &err);
+
+// Reads a checkpoint of the same program and options, restoring the registers and the memory of the program and the
+// tables of the pipeline. Returns false if it cannot be read, is not a checkpoint or does not belong to them, and
+// prints an error to the stream.
+bool loadCheckpoint(const string &path, const settings &set, simulator::program &prog, simulator::pipeline &pipeline,
+					checkpoint &outRes, ostream &err);
+} // namespace runner
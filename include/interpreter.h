@@ -0,0 +1,156 @@
+#pragma once
+
+#include "simulator.h"
+#include <ostream>
+
+namespace simulator
+{
+// Body of every operation once bound to its operands. Inside of it, i is the instruction, r are the registers,
+// m is the memory or a view of it and p is the program counter, which must be moved to the next instruction to
+// execute.
+#define INTERPRETER_OPERATIONS(X)                                                                                     \
+	X(NOP, p++)                                                                                                        \
+	X(ADD, r[i.rD] = r[i.rS] + r[i.rT]; p++)                                                                           \
+	X(ADDU, r[i.rD] = (uint)r[i.rS] + (uint)r[i.rT]; p++)                                                              \
+	X(ADDI, r[i.rT] = r[i.rS] + i.im; p++)                                                                             \
+	X(ADDIU, r[i.rT] = (uint)r[i.rS] + (uint)i.im; p++)                                                                \
+	X(AND, r[i.rD] = r[i.rS] & r[i.rT]; p++)                                                                           \
+	X(ANDI, r[i.rT] = r[i.rS] & i.im; p++)                                                                             \
+	X(NOR, r[i.rD] = ~(r[i.rS] | r[i.rT]); p++)                                                                        \
+	X(NORI, r[i.rT] = ~(r[i.rS] | i.im); p++)                                                                          \
+	X(OR, r[i.rD] = r[i.rS] | r[i.rT]; p++)                                                                            \
+	X(ORI, r[i.rT] = r[i.rS] | i.im; p++)                                                                              \
+	X(SUB, r[i.rD] = r[i.rS] - r[i.rT]; p++)                                                                           \
+	X(SUBU, r[i.rD] = (uint)r[i.rS] - (uint)r[i.rT]; p++)                                                              \
+	X(XOR, r[i.rD] = r[i.rS] ^ r[i.rT]; p++)                                                                           \
+	X(XORI, r[i.rT] = r[i.rS] ^ i.im; p++)                                                                             \
+	X(LB, beforeAccess(m, p); r[i.rT] = m.template load<char>(r[i.rS] + i.im); p++)                                    \
+	X(LH, beforeAccess(m, p); r[i.rT] = m.template load<short>(r[i.rS] + i.im); p++)                                   \
+	X(LW, beforeAccess(m, p); r[i.rT] = m.template load<int>(r[i.rS] + i.im); p++)                                     \
+	X(SB, beforeAccess(m, p); m.template store<char>(r[i.rS] + i.im, r[i.rT]); p++)                                    \
+	X(SH, beforeAccess(m, p); m.template store<short>(r[i.rS] + i.im, r[i.rT]); p++)                                   \
+	X(SW, beforeAccess(m, p); m.template store<int>(r[i.rS] + i.im, r[i.rT]); p++)                                     \
+	X(BEQ, p = r[i.rS] == r[i.rT] ? i.target : p + 1)                                                                  \
+	X(BNE, p = r[i.rS] != r[i.rT] ? i.target : p + 1)                                                                  \
+	X(BGEZ, p = r[i.rS] >= 0 ? i.target : p + 1)                                                                       \
+	X(BGTZ, p = r[i.rS] > 0 ? i.target : p + 1)                                                                        \
+	X(BLEZ, p = r[i.rS] <= 0 ? i.target : p + 1)                                                                       \
+	X(BLTZ, p = r[i.rS] < 0 ? i.target : p + 1)                                                                        \
+	X(J, p = i.target)
+
+// Pairs of an arithmetic instruction followed by a branch, as found at the end of most loops. They are only used inside
+// basic blocks, where j is the branch, which is stored right after i.
+#define INTERPRETER_FUSED_OPERATIONS(X)                                                                               \
+	X(ADD_BEQ, r[i.rD] = r[i.rS] + r[i.rT]; p = r[j.rS] == r[j.rT] ? j.target : p + 2)                                 \
+	X(ADD_BNE, r[i.rD] = r[i.rS] + r[i.rT]; p = r[j.rS] != r[j.rT] ? j.target : p + 2)                                 \
+	X(ADDI_BEQ, r[i.rT] = r[i.rS] + i.im; p = r[j.rS] == r[j.rT] ? j.target : p + 2)                                   \
+	X(ADDI_BNE, r[i.rT] = r[i.rS] + i.im; p = r[j.rS] != r[j.rT] ? j.target : p + 2)                                   \
+	X(SUB_BEQ, r[i.rD] = r[i.rS] - r[i.rT]; p = r[j.rS] == r[j.rT] ? j.target : p + 2)                                 \
+	X(SUB_BNE, r[i.rD] = r[i.rS] - r[i.rT]; p = r[j.rS] != r[j.rT] ? j.target : p + 2)
+
+// BLOCK_END is placed after the operations of every basic block.
+#define INTERPRETER_ENUM(name, body) name,
+enum struct opcode : char {
+	INTERPRETER_OPERATIONS(INTERPRETER_ENUM) INTERPRETER_FUSED_OPERATIONS(INTERPRETER_ENUM) BLOCK_END
+};
+#undef INTERPRETER_ENUM
+
+class threadedInstr;
+typedef void (*handler)(const threadedInstr &i, memory &m, int r[], uint &p);
+
+// Instruction already bound to the code that executes it, so dispatching it takes a single indirect jump.
+class threadedInstr
+{
+  public:
+	handler run;
+	opcode code;
+
+	reg rS;
+	reg rT;
+	reg rD;
+
+	short im;
+	int target;
+};
+
+// Straight-line sequence of instructions that is only entered through its first one and only left after its last one.
+class basicBlock
+{
+  public:
+	uint first; // Position of its first operation in blockOps. The operations end with BLOCK_END.
+	uint instrCnt; // Amount of instructions it executes.
+};
+
+// Access outside of a mapped memory, which ends the program.
+class memoryFault
+{
+  public:
+	uint address; // First address that could not be accessed.
+	int instr; // Index in code of the load or store that accessed it.
+};
+
+// Executes instructions without any timing. The switch dispatch uses decodedInstr::execute, while the threaded
+// dispatch binds every instruction to its operation beforehand. The block dispatch also splits the code into basic
+// blocks the first time they are reached, fusing the pairs of instructions it can, and then executes whole blocks.
+class interpreter
+{
+	span<const decodedInstr> code;
+	memory &mem;
+	int *regs;
+
+	dispatchType dispatch;
+	vector<threadedInstr> bound;
+
+	vector<bool> leaders; // Instructions that start a block.
+	vector<int> blockAt; // Block that starts at every instruction or -1 if it has not been built yet.
+	vector<basicBlock> blocks;
+	vector<threadedInstr> blockOps; // Operations of all the blocks, one after another.
+
+	bool faulted = false;
+	memoryFault fault;
+
+	uint runSwitch(uint &pc, uint count, int trace[]);
+
+	// M is a view of the memory that only does the checks its backend needs.
+	template <class M> uint runThreaded(M &m, uint &pc, uint count, int trace[]);
+	template <class M> uint runBlocks(M &m, uint &pc, uint count, int trace[]);
+	uint runBlocks(uint &pc, uint count, int trace[]);
+	const basicBlock &getBlock(uint start);
+
+	// Calls run, which executes instructions from pc. If the memory is mapped and one of them accesses outside of it,
+	// the fault is caught, the program is ended and 0 is returned.
+	template <class F> uint guard(uint &pc, F run);
+
+  public:
+	interpreter(span<const decodedInstr> code, memory &mem, int regs[], dispatchType dispatch);
+
+	// Executes instructions from pc until count of them have been executed or the program ends.
+	// If trace is not null, the index of every executed instruction is stored in it.
+	// Returns the amount of executed instructions.
+	uint run(uint &pc, uint count, int trace[]);
+
+	// Same as run with the switch dispatch, also storing in addresses the address accessed by every load and store,
+	// at the same position as its index in trace. The rest of the positions are left as they were.
+	uint runWithAddresses(uint &pc, uint count, int trace[], uint addresses[]);
+
+	// Executes the smallest amount of instructions the dispatch can execute at once: a whole block for the block
+	// dispatch and a single instruction otherwise. Returns the amount of executed instructions.
+	uint step(uint &pc, int trace[]);
+
+	// Executes instructions from pc until it gets to target, the program ends or count of them have been executed.
+	// Returns the amount of executed instructions.
+	uint runUntil(uint &pc, uint target, uint count);
+
+	// Access outside of the mapped memory that ended the program or nullptr if there was none.
+	inline const memoryFault *getFault() const
+	{
+		return faulted ? &fault : nullptr;
+	}
+
+	// Executes the whole program with the given dispatch type and with the switch one, checking after every step
+	// that the registers, the memory and the program counter are the same. The given memory and registers are not
+	// modified. Returns false if they differ and prints where to the stream.
+	static bool verify(span<const decodedInstr> code, memory mem, int regs[], dispatchType dispatch, uint limit,
+					   ostream &err);
+};
+} // namespace simulator
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "parseraux.h"
+#include <string>
+#include <string_view>
+
+namespace parser
+{
+// Whole file mapped read-only in memory.
+class mappedFile
+{
+	const char *data = nullptr;
+	size_t size = 0;
+
+  public:
+	mappedFile() = default;
+	mappedFile(const mappedFile &) = delete;
+	mappedFile &operator=(const mappedFile &) = delete;
+	~mappedFile();
+
+	// Returns false if the file does not exist, is not a regular file or cannot be mapped.
+	bool open(const string &path);
+
+	string_view text() const
+	{
+		return string_view(data, size);
+	}
+};
+
+// Front end that tokenizes a source in place instead of going through flex and bison. It accepts the same dialect,
+// prints the same errors and returns the same instructions as parse(), even after a syntax error. It keeps no global
+// state, so several of them can be used at the same time.
+class mappedParser
+{
+	enum struct token : char { END = 0, LABEL, R, IM, LPAREN, RPAREN, SEPARATOR, NEXT, ID };
+
+	// Labels and unknown mnemonics of the instructions. Known mnemonics point to a static table instead.
+	arena mem;
+
+	const char *begin;
+	const char *pos;
+	const char *end;
+	ostream *err;
+
+	// Current lookahead token and its value.
+	token tok;
+	string_view text;
+	int number;
+
+	// Reads the next token, printing the characters that do not belong to any.
+	void next();
+
+	void syntaxError();
+
+	// Returns a copy of the text in uppercase, ended by a null character.
+	const char *copyUpper(string_view str);
+
+	// Returns the mnemonic in uppercase, from the static table if it is a known one.
+	const char *intern(string_view name);
+
+	// Parses an operand starting at the current token, which must be an identifier or an immediate.
+	bool parseOperand(operand &outRes);
+
+	// Parses the operands of an instruction after its name.
+	bool parseOperands(instruction &outRes);
+
+  public:
+	// Instructions are valid until the parser is destroyed or used again, but do not refer to the text.
+	vector<instruction> parse(string_view source, ostream &err);
+};
+} // namespace parser
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "pipeline.h"
+
+namespace simulator
+{
+// Register that holds the index of the core, from 0, when the simulation starts. It is $k0, which programs that
+// only use the simulator have no other use for.
+static const reg coreIdReg = 26;
+
+// How the cores are simulated. All of them use the same pipeline configuration.
+class coreConfig
+{
+  public:
+	uint cores;
+	uint quantum; // Instructions every core executes between two barriers.
+	forwardingType forwarding;
+	branchPredType branchPred;
+	bool branchInDec;
+	predictorConfig predictor;
+	dispatchType dispatch;
+};
+
+// Statistics of one of the cores.
+class coreResult
+{
+  public:
+	uint instrCnt = 0;
+	uint cycles = 0;
+	bool limitReached = false; // The simulation of the core was stopped because it went over the limit of cycles.
+	bool faulted = false;
+	memoryFault fault; // Only valid if faulted.
+};
+
+// Simulates several cores running the program from the start, each with its own registers and pipeline but sharing
+// its memory. Every quantum, each core first executes its next instructions in the order of the cores, so that the
+// memory sees the same accesses in every run, and then the pipelines of all of them simulate those instructions in
+// parallel. Stops at the first access outside of a mapped memory. Returns false if a core faulted.
+bool simulateCores(program &prog, const coreConfig &config, uint limit, uint threads, vector<coreResult> &results);
+} // namespace simulator
@@ -1,4 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 using namespace std;
@@ -12,19 +17,71 @@ typedef struct indirect {
 	int reg;
 } indirect;
 
+// Operands are stored inline, only labels point to memory of the parser.
 typedef struct operand {
 	optype type;
-	void *ptr;
+	union {
+		const char *label; // OPLABEL
+		indirect indir; // OPINDIRECT
+		int im; // OPIM
+	};
 } operand;
 
 typedef struct instruction {
 	const char *label;
 	const char *name;
-	const int *rlist;
+	int rlist[3];
 	int rcount;
 	operand op;
 } instruction;
 
-std::vector<instruction> parse(istream *in);
+// Bump allocator for the strings of parsed instructions, which are all freed at once. Only for trivially
+// destructible objects, since no destructor is ever called.
+class arena
+{
+	static constexpr size_t chunkSize = 64 << 10;
+
+	vector<unique_ptr<char[]>> chunks;
+	char *next = nullptr;
+	size_t left = 0;
+
+  public:
+	// Returns uninitialized memory, valid until the arena is cleared or destroyed.
+	void *alloc(size_t size, size_t align = alignof(max_align_t))
+	{
+		size_t padding = -(uintptr_t)next & (align - 1);
+
+		if (padding + size > left) {
+			// Big requests get a chunk of their own, so the current one can still be used.
+			if (size + align > chunkSize) {
+				chunks.emplace_back(new char[size + align]);
+				char *ptr = chunks.back().get();
+				return ptr + (-(uintptr_t)ptr & (align - 1));
+			}
+
+			chunks.emplace_back(new char[chunkSize]);
+			next = chunks.back().get();
+			left = chunkSize;
+			padding = -(uintptr_t)next & (align - 1);
+		}
+
+		void *ptr = next + padding;
+		next += padding + size;
+		left -= padding + size;
+		return ptr;
+	}
+
+	void clear()
+	{
+		chunks.clear();
+		next = nullptr;
+		left = 0;
+	}
+};
+
+// Errors are printed to err. Strings of the instructions are valid until freeResources is called.
+std::vector<instruction> parse(istream *in, ostream *err);
+
+// Frees every string of the last parse at once.
 void freeResources();
 } // namespace parser
\ No newline at end of file
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "cache.h"
+#include "interpreter.h"
+#include "predictor.h"
+
+namespace simulator
+{
+// Cycles in which an instruction went through the pipeline phases.
+// The memory and write-back phases always come right after the execution phase.
+class timing
+{
+  public:
+	int idx = -1; // Index in code of the instruction or -1 for a bubble.
+	uint fetch; // First cycle in the fetch phase.
+	uint decode; // First cycle in the decode phase.
+	uint execute; // Cycle in the execution phase.
+	uint penalty; // Cycles without fetching after this instruction because it is a branch or a jump.
+	bool taken; // It is a branch that was taken or a jump.
+};
+
+// Why no instruction entered the execution phase in a cycle.
+enum struct stallType : char {
+	NONE = 0, // An instruction did.
+	DATA, // The instruction in the decode phase waits for an operand.
+	CONTROL, // Nothing was fetched until a branch or a jump was resolved.
+	EMPTY, // The pipeline is still filling at the start or draining at the end.
+	MEMORY // The load or store in the decode phase waits for its line to get to the data cache.
+};
+
+// Registers used and written by an instruction, calculated once per instruction in the code.
+class hazardInfo
+{
+  public:
+	uint sources = 0; // Mask of the registers read, apart from $0.
+	reg rS;
+	reg rT;
+	reg written = -1; // -1 if it writes no register.
+	pipPhase rSNeeded;
+	pipPhase rTNeeded;
+	pipPhase resultDone;
+};
+
+// Everything a pipeline keeps between cycles apart from the program itself, so that a simulation can be saved and
+// resumed later. It is only valid for the same code and options.
+class pipelineState
+{
+  public:
+	static const uint maxPending = 64;
+
+	timing ifLatch, idLatch, exLatch, memLatch, wbLatch;
+
+	uint execCycle[32];
+	pipPhase resultDone[32];
+	uint inFlight;
+
+	uint pc;
+	uint fetchFrom;
+	uint controlEnd;
+	int controlIdx;
+	uint cycle;
+	bool issued;
+	stallType stall;
+
+	predictorStats predictions;
+
+	// Data cache accesses of the instructions in the fetch and decode phases.
+	uint ifAddress, idAddress;
+	bool idAccessed;
+	uint lineReady;
+
+	// Instructions already executed by the interpreter but not fetched yet.
+	uint pendingCnt;
+	int pending[maxPending];
+	uint pendingAddr[maxPending]; // Only recorded with the data cache.
+};
+
+static_assert(is_trivially_copyable_v<pipelineState>);
+
+// Standard 5-phase MIPS pipeline. All latches advance once per cycle, and instructions wait in the decode
+// phase until all of their operands can be read or forwarded.
+class pipeline
+{
+	static const uint aheadSize = pipelineState::maxPending;
+
+	span<const decodedInstr> code;
+	interpreter *interp; // nullptr when replaying a recorded trace.
+
+	forwardingType forwarding;
+	branchPredType branchPred;
+	bool branchInDec;
+
+	// Only trained with the dynamic prediction types. It is updated as soon as a branch is fetched, since the
+	// outcome is already known from the interpreter.
+	branchPredictor predictor;
+	predictorStats stats;
+
+	// Only used when executing the program, since the addresses are recorded while the instructions execute. A miss
+	// is charged before the load or store enters the execution phase, so that its memory phase still comes right
+	// after it.
+	dataCache cache;
+	bool withAddresses; // Addresses are recorded, for the data cache or to be asked for.
+	uint ifAddress = 0, idAddress = 0, exAddress = 0; // Accessed by the load or store in each of the phases.
+	bool idAccessed = false; // The instruction in the decode phase already accessed the cache.
+	uint lineReady = 0; // First cycle in which the line of that access is in the cache.
+
+	// Instruction in each of the phases or a bubble.
+	timing ifLatch, idLatch, exLatch, memLatch, wbLatch;
+
+	vector<hazardInfo> hazards;
+
+	// Scoreboard with the cycle in which the youngest instruction writing each register was in the execution
+	// phase, and in which phase its result is ready. Registers whose value is not in the register file yet are
+	// also kept in a mask, so that most instructions are checked without looking at the cycles.
+	uint execCycle[32];
+	pipPhase resultDone[32];
+	uint inFlight = 0;
+
+	uint pc = 0; // Next instruction to execute.
+
+	// Instructions are executed in batches ahead of the pipeline, which then fetches them in order.
+	// When replaying a recorded trace, the whole trace is used as a single batch.
+	int aheadBuf[aheadSize];
+	const int *ahead = aheadBuf;
+	uint aheadAddr[aheadSize]; // Address accessed by each load and store, only recorded with the data cache.
+	uint aheadCnt = 0;
+	uint aheadPos = 0;
+
+	uint fetchFrom = 0; // First cycle where fetching is allowed. Used to wait for branches and jumps.
+	uint controlEnd = 0; // Last cycle without instructions to execute because of the last branch or jump.
+	int controlIdx = -1; // Index in code of the last branch or jump with a penalty.
+	bool issued = false; // An instruction entered the execution phase in the last cycle.
+	stallType stall = stallType::EMPTY;
+
+	// Returns whether the instruction in the decode phase can enter the execution phase in the next cycle,
+	// checking its operands against the scoreboard.
+	bool canExecute();
+
+	// Returns whether the value of the register can be read or forwarded for a phase of an instruction that
+	// enters the execution phase in the current cycle.
+	bool isReady(reg r, pipPhase needed);
+
+	// Returns whether the instruction in the decode phase is not a load or store waiting for the data cache,
+	// accessing it the first time.
+	bool hasLine();
+
+	// Returns whether there are instructions left to fetch, executing the next batch if needed.
+	bool hasNext();
+
+	// Fetches the next executed instruction.
+	void fetch();
+
+  public:
+	uint cycle = 0; // Next cycle to simulate.
+
+	// Starts empty, fetching from the instruction startPc. It is not 0 when the instructions before it were already
+	// executed without timing. With addresses, the address accessed by every load and store can be asked for even
+	// without a data cache.
+	pipeline(span<const decodedInstr> code, interpreter &interp, forwardingType forwarding, branchPredType branchPred,
+			 bool branchInDec, const predictorConfig &predictor = {}, const cacheConfig &cache = {}, uint startPc = 0,
+			 bool addresses = false);
+
+	// Replays the instructions executed by a previous run, which ended with endPc as the program counter.
+	// The trace must outlive the pipeline.
+	pipeline(span<const decodedInstr> code, const vector<int> &trace, uint endPc, forwardingType forwarding,
+			 branchPredType branchPred, bool branchInDec, const predictorConfig &predictor = {});
+
+	// Starts replaying another trace from an empty pipeline, without analyzing the code again. Only for pipelines
+	// that replay a trace. The branch predictor keeps what it learned from the previous ones.
+	void replay(const vector<int> &trace, uint endPc);
+
+	// Adds the instructions executed after the ones it already has without emptying the pipeline, so that a trace can
+	// be replayed while it is being recorded. The trace must start with the pending instructions, and endPc is the
+	// program counter after it. Only for pipelines that replay a trace.
+	void extend(const vector<int> &trace, uint endPc);
+
+	// Instructions of the trace that have not been fetched yet.
+	inline uint pending() const
+	{
+		return aheadCnt - aheadPos;
+	}
+
+	// Whether the program has not finished and more of the trace is needed to simulate the next cycle. Fetching a
+	// branch also looks at the instruction after it, so two must be left.
+	inline bool needsTrace() const
+	{
+		return pc < code.size() && aheadCnt - aheadPos < 2;
+	}
+
+	// Simulates one cycle. Returns false once the program has finished and the pipeline is empty.
+	bool step();
+
+	// Returns the instruction that entered the execution phase in the last cycle or nullptr if it was a bubble.
+	const timing *executing();
+
+	// Returns the address accessed by the load or store that entered the execution phase in the last cycle. Only for
+	// pipelines that record addresses.
+	uint executingAddress() const;
+
+	// Returns why there was a bubble in the execution phase in the last cycle and the index in code of the
+	// instruction that caused it, or -1 if there is none.
+	stallType stalled(int &idx) const;
+
+	// Returns how the branches and jumps fetched so far were predicted.
+	const predictorStats &predictions() const;
+
+	// Returns the hits and misses of the data cache so far.
+	const cacheStats &cacheAccesses() const;
+
+	// Saves the state between cycles. Only for pipelines that execute the program, not for replayed ones.
+	pipelineState getState() const;
+
+	// Resumes from a saved state. The registers and the memory must already be the ones saved with it.
+	void setState(const pipelineState &state);
+
+	// Writes the tables of the branch predictor and the data cache, which are not part of the state since their size
+	// depends on the configuration.
+	void saveTables(ostream &out) const;
+
+	// Restores the tables saved by a pipeline with the same configuration, removing them from the start of the data.
+	// Returns false if they are not valid.
+	bool loadTables(string_view &data);
+};
+} // namespace simulator
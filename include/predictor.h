@@ -0,0 +1,109 @@
+#pragma once
+
+#include "simulator.h"
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+namespace simulator
+{
+// Sizes of the tables of the dynamic branch predictors. All of them must be powers of two.
+class predictorConfig
+{
+  public:
+	uint tableSize = 1024; // Counters indexed by the address of the branch.
+	uint historyBits = 8; // Outcomes of the last branches kept for gshare.
+	uint btbSize = 0; // Entries of the branch target buffer, 0 to know the target of every branch when it is fetched.
+
+	bool operator==(const predictorConfig &other) const = default;
+};
+
+// How well the branches and jumps were predicted.
+class predictorStats
+{
+  public:
+	uint64_t branches = 0;
+	uint64_t mispredicted = 0; // Branches fetched with a penalty, whether the direction or the target was wrong.
+	uint64_t jumps = 0;
+	uint64_t btbLookups = 0; // Jumps and branches predicted as taken, which need a target.
+	uint64_t btbHits = 0;
+	uint64_t penaltyCycles = 0; // Cycles without fetching after every branch and jump.
+};
+
+// Dynamic branch predictor with saturating counters and an optional branch target buffer. The tables are flat
+// arrays indexed by masking the index of the branch in the code, so a prediction is a couple of loads.
+class branchPredictor
+{
+	branchPredType type;
+
+	vector<uint8_t> counters;
+	uint tableMask;
+	uint8_t counterMax; // 1 for the 1-bit predictor, 3 for the 2-bit ones.
+
+	uint history = 0; // Outcome of the last branches, the most recent one in the lowest bit.
+	uint historyMask;
+
+	// Entries of the branch target buffer, tagged with the whole index of the branch, -1 when empty.
+	vector<int> btbTags;
+	vector<int> btbTargets;
+	uint btbMask;
+
+	inline uint counterIdx(uint idx) const
+	{
+		return (type == branchPredType::GSHARE ? idx ^ history : idx) & tableMask;
+	}
+
+  public:
+	branchPredictor(branchPredType type, const predictorConfig &config);
+
+	// Whether the branch is predicted as taken.
+	inline bool predict(uint idx) const
+	{
+		return counters[counterIdx(idx)] > counterMax / 2;
+	}
+
+	// Trains the predictor with the outcome of the branch.
+	inline void update(uint idx, bool taken)
+	{
+		uint8_t &counter = counters[counterIdx(idx)];
+
+		if (taken && counter < counterMax) counter++;
+		else if (!taken && counter > 0) counter--;
+
+		history = ((history << 1) | taken) & historyMask;
+	}
+
+	inline bool hasBtb() const
+	{
+		return !btbTags.empty();
+	}
+
+	// Returns the target of the branch or jump saved in the branch target buffer, -1 if it is not there.
+	inline int findTarget(uint idx) const
+	{
+		uint entry = idx & btbMask;
+		return btbTags[entry] == (int)idx ? btbTargets[entry] : -1;
+	}
+
+	// Saves the target of a branch or jump that was taken, replacing the one with the same entry.
+	inline void addTarget(uint idx, uint target)
+	{
+		uint entry = idx & btbMask;
+		btbTags[entry] = idx;
+		btbTargets[entry] = target;
+	}
+
+	// Writes the history and the tables, whose sizes only depend on the configuration.
+	void save(ostream &out) const;
+
+	// Restores what save wrote for the same type and configuration, removing it from the start of the data. Returns
+	// false if the data is too short or a counter is out of range.
+	bool load(string_view &data);
+};
+
+// Returns whether the branch prediction type learns from the executed branches.
+inline bool isDynamic(branchPredType type)
+{
+	return type >= branchPredType::ONE_BIT;
+}
+} // namespace simulator
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "simulator.h"
+#include <ostream>
+#include <string>
+
+namespace translator
+{
+// Writes an already translated program to a binary file, so that it can be simulated again without parsing and
+// verifying it. Returns false if the file cannot be written and prints an error to the stream.
+bool saveProgram(const simulator::program &prog, const string &path, ostream &err);
+
+// Loads a program written by saveProgram, mapping the file in memory. Returns false if it cannot be read, is not a
+// compiled program or was written by a different version, and prints an error to the stream.
+bool loadCompiled(const string &path, simulator::program &outRes, ostream &err);
+} // namespace translator
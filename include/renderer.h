@@ -0,0 +1,121 @@
+#pragma once
+
+#include "multicore.h"
+#include "pipeline.h"
+#include "sampler.h"
+#include "sweep.h"
+#include <ostream>
+
+namespace renderer
+{
+// Position of the next row of a diagram, to resume printing it from a checkpoint.
+class diagramState
+{
+  public:
+	uint fetchpos;
+	uint lastpos;
+	uint lastExecute;
+	uint lastPenalty;
+	uint instrCnt;
+	bool lastBranch;
+};
+
+// Columns of the phases of an instruction in the diagram. Stalls go from stallStart to right before stallEnd.
+class diagramRow
+{
+  public:
+	int idx;
+	uint fcol;
+	uint dcol;
+	uint stallStart;
+	uint stallEnd;
+	uint execute;
+};
+
+// Prints the pipeline diagram while the program executes, one row per executed instruction.
+// Only the state needed to place the next row is kept, so memory does not grow with the run length.
+// When compressing loops, the rows of every iteration are kept until the next one starts. Iterations with the same
+// instructions and stalls as the previous one are not printed, and the rows after them are moved to the left.
+class diagram
+{
+	ostream &out;
+	vector<simulator::instruction> &codeText;
+	simulator::instruction nop;
+
+	bool useRegularNOPs;
+	bool useTabs;
+	bool statsOnly; // Only count, without printing any rows.
+	bool stallsDec; // Stalls are placed before the decoding phase.
+	bool compressLoops;
+
+	// Saves in what column the instructions start to be printed.
+	// This is done to align to all labels correctly.
+	uint instrcol = 0;
+
+	// Saves in what column the pipeline diagram will start.
+	// Similar to instrcol, this is done to properly align it in all lines.
+	uint diagramStart = 0;
+
+	vector<string> instrTexts; // Every instruction of the code as printed at the start of its rows.
+	string line; // Row being formatted, reused so that it is written at once without allocating each time.
+
+	uint fetchpos = 0; // Position of the next fetch (first phase) in the pipeline diagram.
+	uint lastpos = 0; // Position of the last phase in the map (used for counting cycles).
+	uint lastExecute = 1; // Cycle in which the last instruction was in the execution phase.
+	uint lastPenalty = 0; // Penalty of the last instruction if it was a branch or a jump.
+	uint instrCnt = 0; // Amount of actual instructions (removing SNOPs).
+
+	bool lastBranch = false; // Last instruction was a branch.
+
+	// An iteration starts at every backward jump. Very long ones are printed without waiting for them to end.
+	static const uint maxIterationRows = 4096;
+
+	vector<diagramRow> iteration; // Rows since the last backward jump, not printed yet.
+	vector<diagramRow> lastIteration; // Rows of the previous iteration, empty if it could not be compared.
+	uint repeats = 0; // Iterations equal to the previous one that were not printed.
+	uint repeatedCycles = 0; // Cycles between the starts of the iterations that were not printed.
+	uint shift = 0; // Columns to move the rows to the left, from all the iterations that were not printed.
+
+	void printRow(const diagramRow &row);
+
+	// Returns whether the iteration has the same rows as the previous one, relative to the start of each one.
+	bool isRepeated() const;
+
+	// Prints the rows of the iteration unless it repeats the previous one.
+	void endIteration(bool repeated);
+
+	// Prints how many iterations were not printed, if any.
+	void printRepeats();
+
+  public:
+	diagram(ostream &out, vector<simulator::instruction> &codeText, bool useRegularNOPs, bool useTabs, bool statsOnly,
+			bool compressLoops, simulator::forwardingType forwarding);
+
+	// Adds the row of an instruction once it enters the execution phase.
+	void addInstr(const simulator::timing &t);
+
+	diagramState getState() const;
+
+	// Continues after the rows of a saved state, which are not printed again.
+	void setState(const diagramState &state);
+
+	// Prints the amount of cycles and the average CPI. Should be called once the execution has finished.
+	// When only printing statistics, the amount of instructions and stalls is also printed.
+	void finish();
+};
+
+// Prints a table comparing the statistics of every configuration in a sweep.
+void printSweep(ostream &out, const vector<simulator::sweepResult> &results);
+
+// Prints the accuracy of the branch predictor and the cycles lost to branches and jumps.
+void printPredictions(ostream &out, const simulator::predictorStats &stats);
+
+// Prints the hits and misses of the data cache.
+void printCache(ostream &out, const simulator::cacheStats &stats);
+
+// Prints the statistics estimated by sampling, with their confidence interval.
+void printSample(ostream &out, const simulator::sampleResult &result);
+
+// Prints a table with the statistics of every core and the throughput of all of them together.
+void printCores(ostream &out, const vector<simulator::coreResult> &results);
+} // namespace renderer
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "cache.h"
+#include "predictor.h"
+#include <istream>
+#include <ostream>
+#include <string_view>
+
+namespace runner
+{
+// Options that change how a program is simulated and printed.
+class settings
+{
+  public:
+	bool useRegularNOPs = false;
+	bool branchInDec = false;
+	bool useTabs = false;
+	bool statsOnly = false;
+	bool compressLoops = false; // Print iterations of loops that repeat the previous one only once.
+	bool checkDispatch = false;
+	bool sweep = false;
+	bool mapInput = false; // Map input files in memory and tokenize them in place instead of using flex and bison.
+	bool mapMemory = false; // Reserve the address space at once, so that accesses outside of memorySize are errors.
+	uint memorySize = 0; // Bytes of the mapped memory, at least the ones taken by the variables.
+	uint instrLimit = 256; // Instruction limit (to prevent infinite loops)
+	uint jobs = 0; // Threads used in parallel, 0 to use as many as the hardware supports.
+	simulator::forwardingType forwarding = simulator::forwardingType::NONE;
+	simulator::branchPredType branchPred = simulator::branchPredType::NONE;
+	simulator::predictorConfig predictor; // Only used by the dynamic branch prediction types.
+	simulator::cacheConfig cache;
+	simulator::dispatchType dispatch = simulator::dispatchType::SWITCH;
+	string compilePath; // If not empty, the program is saved to this file instead of being simulated.
+	string checkpointPath; // If not empty, the state is saved to this file every checkpointEvery cycles.
+	uint checkpointEvery = 1000000;
+	string restorePath; // If not empty, the simulation resumes from the checkpoint in this file.
+	string tracePath; // If not empty, every executed instruction and stall is also written to this file.
+	uint samplePeriod = 0; // If not 0, only a window every samplePeriod instructions is simulated in detail.
+	uint sampleWindow = 1000;
+	uint sampleWarmup = 100;
+	uint cores = 1; // If more than 1, every core runs the program with its index in $26, sharing the memory.
+	uint quantum = 10000; // Instructions every core executes between two barriers.
+	uint skipCount = 0; // Instructions executed without timing before the simulation starts.
+	string skipLabel; // If not empty, the simulation starts the first time this label is reached.
+};
+
+class result
+{
+  public:
+	bool ok = false;
+	uint instrCnt = 0;
+	uint cycles = 0; // 0 when several configurations were simulated, estimated when sampling.
+};
+
+// Simulates a program, printing the diagram, the statistics, the sweep or the estimate to out and any error to err.
+// Saves it instead if a compile path is set.
+result run(simulator::program &prog, const settings &set, ostream &out, ostream &err);
+
+// Loads and simulates a program. Can be called from several threads, although only one of them loads at a time.
+result runFile(istream &in, const settings &set, ostream &out, ostream &err);
+
+// Loads a source that is already in memory with the front end that tokenizes it in place, and simulates it. Can be
+// called from several threads at the same time.
+result runSource(string_view source, const settings &set, ostream &out, ostream &err);
+
+// Loads a program saved with the compile path, without parsing it, and simulates it.
+result runCompiled(const string &path, const settings &set, ostream &out, ostream &err);
+
+// Simulates every file in parallel, writing the output of each one to a file with the same name and the .out
+// extension in outDir, or next to the input if outDir is empty. Errors also go to that file, so a wrong input does
+// not stop the others. Prints a summary with a line per file. Returns false if any of them failed.
+bool runBatch(const vector<string> &files, const string &outDir, const settings &set, ostream &summary);
+} // namespace runner
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pipeline.h"
+
+namespace simulator
+{
+// How often and for how long the pipeline is simulated in detail.
+class sampleConfig
+{
+  public:
+	uint period; // Instructions from the start of a window to the start of the next one.
+	uint window; // Instructions measured in every window.
+	uint warmup; // Instructions simulated before every window, but not measured, to fill the pipeline.
+	forwardingType forwarding;
+	branchPredType branchPred;
+	bool branchInDec;
+	predictorConfig predictor;
+};
+
+// Estimate of the statistics of the whole program from the measured windows.
+class sampleResult
+{
+  public:
+	uint64_t instrCnt = 0;
+	uint64_t sampledCnt = 0; // Instructions measured in detail.
+	uint windows = 0;
+	double cycles = 0;
+	double cyclesError = 0; // Half of the 95% confidence interval, NaN with too few windows to know it.
+};
+
+// Executes the program with the interpreter from the instruction pc, simulating the pipeline only in a window at the
+// start of every period and extrapolating the cycles of the rest from the average cycles per instruction of the
+// windows. Returns false if the program executes more than limit instructions.
+bool sample(span<const decodedInstr> code, interpreter &interp, uint pc, const sampleConfig &config, uint limit,
+			sampleResult &outRes);
+} // namespace simulator
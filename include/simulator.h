@@ -1,6 +1,12 @@
+#pragma once
+
 #include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
 #include <vector>
 
 #if WINNT
@@ -58,7 +64,9 @@ enum struct regType : char { NONE = 0, RS, RT, RD };
 
 enum struct forwardingType : char { NONE = 0, FULL, ALU };
 
-enum struct branchPredType : char { NONE = 0, PERFECT, TAKEN, NOT_TAKEN };
+enum struct branchPredType : char { NONE = 0, PERFECT, TAKEN, NOT_TAKEN, ONE_BIT, TWO_BIT, GSHARE };
+
+enum struct dispatchType : char { SWITCH = 0, THREADED, BLOCK };
 
 class varDef
 {
@@ -69,39 +77,177 @@ class varDef
 	uint value;
 };
 
+// Data memory covering the whole 32-bit address space. It is split in pages, which are only allocated the first
+// time they are accessed, so it takes as much memory as the addresses the program actually uses. Pages that were
+// never accessed contain zeros.
+// Once mapped, the whole address space is reserved at once instead, with only the first bytes accessible, so that
+// accesses need no checks and the ones outside of them fault. Copies of a mapped memory use pages again.
 class memory
 {
-	vector<char> internalMem;
+  public:
+	static constexpr uint pageBits = 12;
+	static constexpr uint pageSize = 1 << pageBits;
+
+  private:
+	// Two-level page table: every table covers 1024 pages and is created with the first of them. Entries are the
+	// position in pages plus one, or 0 if the page has not been allocated.
+	static const uint tableBits = 10;
+	vector<vector<uint>> tables;
+
+	vector<vector<char>> pages; // In the order they were allocated. Moving them keeps their data in place.
+	vector<uint> pageNumbers; // Address divided by the page size of every page.
+
+	uint used = 0; // Bytes taken by the variables, from address 0.
+
+	// Last page accessed, so that consecutive accesses to the same page skip the page table.
+	uint lastPage = UINT32_MAX;
+	char *lastData = nullptr;
+
+	char *mapped = nullptr; // Start of the reserved address space, if mapped.
+	uint mappedPages = 0; // Pages from the start that can be accessed.
+
+	// Returns the data of the page, allocating it if needed.
+	char *touch(uint page);
+
+	// Returns the data of the page or nullptr if it has not been allocated.
+	const char *find(uint page) const;
+
+	// Copies the contents of the other memory, which must be paged, to the pages of this one.
+	void copyPages(const memory &other);
+
+	// Accesses a value split between two pages one byte at a time, which is rare enough not to need to be fast.
+	template <integral T> T loadSplit(uint idx)
+	{
+		T value;
+		for (uint i = 0; i < sizeof(T); i++)
+			((char *)&value)[i] = *getPaged<char>(idx + i);
+
+		return value;
+	}
+
+	template <integral T> void storeSplit(uint idx, T value)
+	{
+		for (uint i = 0; i < sizeof(T); i++)
+			*getPaged<char>(idx + i) = ((const char *)&value)[i];
+	}
+
+	void unmap();
 
   public:
-	// Gets the value in memory at the given index or nullptr if out of bounds.
+	memory();
+	memory(const memory &other);
+	memory &operator=(const memory &other);
+	~memory();
+
+	// Gets the value in memory at the given index or nullptr if it is split between two pages. Mapped memories never
+	// return nullptr, even for accesses outside of them.
 	template <integral T> T *get(uint idx)
 	{
-		if (idx < 0) return nullptr;
+		if (mapped != nullptr) return (T *)(mapped + idx);
+		return getPaged<T>(idx);
+	}
+
+	// Same as get, for memories that are known not to be mapped.
+	template <integral T> T *getPaged(uint idx)
+	{
+		uint offset = idx & (pageSize - 1);
+		if (offset > pageSize - sizeof(T)) return nullptr;
+
+		uint page = idx >> pageBits;
+		if (page != lastPage) {
+			lastData = touch(page);
+			lastPage = page;
+		}
 
-		uint end = idx + sizeof(T);
-		if (internalMem.size() < end) return nullptr;
+		return (T *)(lastData + offset);
+	}
 
-		return (T *)&internalMem[idx];
+	// Reads the value at the given index, also if it is split between two pages.
+	template <integral T> T load(uint idx)
+	{
+		if (mapped != nullptr) return *(T *)(mapped + idx);
+		return loadPaged<T>(idx);
+	}
+
+	// Writes the value at the given index, also if it is split between two pages.
+	template <integral T> void store(uint idx, T value)
+	{
+		if (mapped != nullptr) *(T *)(mapped + idx) = value;
+		else storePaged<T>(idx, value);
 	}
 
-	// Adds the variable to memory. Returns the resulting index in memory.
+	// Same as load and store, for memories that are known not to be mapped.
+	template <integral T> T loadPaged(uint idx)
+	{
+		if (T *ptr = getPaged<T>(idx)) return *ptr;
+		return loadSplit<T>(idx);
+	}
+
+	template <integral T> void storePaged(uint idx, T value)
+	{
+		if (T *ptr = getPaged<T>(idx)) *ptr = value;
+		else storeSplit<T>(idx, value);
+	}
+
+	// Adds the variable to memory after the previous ones. Returns the resulting index in memory.
 	int add(varDef def);
 
-	// Frees unused memory. Should be called after all variables have been added.
-	void shrink();
+	// Bytes taken by the variables.
+	inline uint size() const
+	{
+		return used;
+	}
+
+	// Copies the contents from the index, used to save translated programs.
+	void read(uint idx, char *data, uint size) const;
 
-	inline int size()
+	// Replaces the contents with a copy of the variables of a saved program, starting at index 0.
+	void load(const char *data, uint size);
+
+	// Moves the contents to a reservation of the whole address space where only the first size bytes, rounded up to
+	// whole pages, can be accessed. Returns false if it could not be reserved.
+	bool map(uint size);
+
+	// Start of the reserved address space or nullptr if the memory is not mapped.
+	inline char *mappedData() const
+	{
+		return mapped;
+	}
+
+	// Bytes from the start of a mapped memory that can be accessed.
+	inline uint64_t mappedSize() const
 	{
-		return internalMem.size();
+		return (uint64_t)mappedPages * pageSize;
 	}
+
+	// Pages allocated so far, used to save the contents of the whole address space. Always 0 for mapped memories.
+	inline uint pageCnt() const
+	{
+		return pages.size();
+	}
+
+	inline uint pageNumber(uint i) const
+	{
+		return pageNumbers[i];
+	}
+
+	inline const char *pageData(uint i) const
+	{
+		return pages[i].data();
+	}
+
+	// Replaces the contents of the page with the given number.
+	void loadPage(uint number, const char *data);
+
+	// Whether both have the same contents in the whole address space.
+	bool operator==(const memory &other) const;
 };
 
-class instruction
+// Compact form of an instruction used by the execution loop. It is trivially copyable and all label
+// operands are already resolved to code indices, so no strings are involved while executing.
+class decodedInstr
 {
   public:
-	string label;
-	string displayName;
 	instrType type;
 	operation op;
 
@@ -116,24 +262,65 @@ class instruction
 	} flags;
 
 	short im;
-	string labelOp;
+	int target; // Index in code of the label operand or -1 if unused.
 
-	void execute(memory &mem, int regs[], unordered_map<string, int> &labelMap, uint &pc);
+	void execute(memory &mem, int regs[], uint &pc) const;
 
 	// Returns the first pipeline phase where the value is rS is needed.
-	pipPhase calcRSNeeded();
+	pipPhase calcRSNeeded() const;
 
 	// Returns the first pipeline phase where the value is rT is needed.
-	pipPhase calcRTNeeded();
+	pipPhase calcRTNeeded() const;
 
 	// Returns the first pipeline phase where the result is ready. (At the end of the phase)
-	pipPhase calcResultDone();
+	pipPhase calcResultDone() const;
 
 	// Returns in which register the result is written.
-	regType getRegWritten();
+	regType getRegWritten() const;
+};
+
+static_assert(is_trivially_copyable_v<decodedInstr>);
+
+// Full instruction as written in the source code. Only used for translation and printing.
+class instruction : public decodedInstr
+{
+  public:
+	string label;
+	string displayName;
+	string labelOp;
 
 	// Transforms the instruction to a string, starting the instruction portion (after label)
 	// in at least the given column.
 	string toString(uint minCol);
 };
+
+// Program ready to be simulated, with its data already placed in memory and registers.
+class program
+{
+	vector<decodedInstr> ownedCode; // Empty when the code is used in place from an image.
+	shared_ptr<const void> image; // Keeps the file the code was loaded from mapped while it is used.
+	function<void(vector<instruction> &)> textLoader; // Builds codeText if it was not built with the code.
+
+  public:
+	memory dataMem;
+	int regs[32] = {};
+
+	vector<instruction> codeText; // Instructions as written in the source code, only used for printing. See loadText.
+	span<const decodedInstr> code; // Compact instructions used by the execution loop.
+
+	program() = default;
+	program(const program &other);
+	program &operator=(const program &other);
+
+	// Makes the program own its compact instructions.
+	void setCode(vector<decodedInstr> instrs);
+
+	// Uses compact instructions that are in a mapped image, which is kept alive while the program is. The texts are
+	// only built by the loader once loadText is called.
+	void setImage(span<const decodedInstr> instrs, shared_ptr<const void> owner,
+				  function<void(vector<instruction> &)> loader);
+
+	// Builds codeText if it was left for later, which is needed before printing anything about the instructions.
+	void loadText();
+};
 } // namespace simulator
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "pipeline.h"
+
+namespace simulator
+{
+// Statistics of simulating the pipeline with one configuration.
+class sweepResult
+{
+  public:
+	forwardingType forwarding;
+	branchPredType branchPred;
+	bool branchInDec;
+
+	uint instrCnt = 0;
+	uint cycles = 0;
+	bool limitReached = false; // The simulation was stopped because it went over the limit of cycles.
+};
+
+// Executes the program once from the instruction pc and simulates every combination of forwarding, branch prediction
+// and branch resolution phase over the executed instructions in parallel. The program is executed a chunk at a time,
+// which every configuration simulates before the next one, so that only a chunk is kept. The dynamic predictors all
+// use the same table sizes. Returns false if the program does not finish within the limit, in
+// which case no configuration can.
+bool sweep(span<const decodedInstr> code, interpreter &interp, uint pc, uint limit, uint threads,
+		   const predictorConfig &predictor, vector<sweepResult> &results);
+} // namespace simulator
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if WINNT
+typedef unsigned int uint;
+#endif
+
+using namespace std;
+
+namespace parallel
+{
+// Fixed set of threads that run the submitted tasks in any order. Every thread has its own queue, and threads
+// that run out of tasks steal them from the others, so uneven tasks still keep all of them busy.
+class threadPool
+{
+	class taskQueue
+	{
+	  public:
+		mutex lock;
+		deque<function<void()>> tasks;
+	};
+
+	vector<unique_ptr<taskQueue>> queues;
+	vector<thread> workers;
+
+	atomic<uint> nextQueue = 0; // Queue for the next submitted task, used in turns.
+	atomic<uint> queued = 0; // Tasks waiting in any queue.
+
+	mutex idleLock;
+	condition_variable taskReady;
+	condition_variable allDone;
+	uint pending = 0; // Tasks submitted but not finished yet. Protected by idleLock.
+	bool stopping = false;
+
+	// Takes a task from the front of the queue of the thread or, if empty, from the back of another one.
+	bool take(uint self, function<void()> &task);
+
+	void work(uint self);
+
+  public:
+	// Uses as many threads as the hardware supports if threads is 0.
+	threadPool(uint threads);
+	~threadPool();
+
+	void submit(function<void()> task);
+
+	// Waits until all the submitted tasks have finished.
+	void wait();
+};
+} // namespace parallel
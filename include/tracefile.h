@@ -0,0 +1,134 @@
+#pragma once
+
+#include "asyncwriter.h"
+#include "pipeline.h"
+#include <bit>
+#include <cstdint>
+#include <fstream>
+
+namespace renderer
+{
+// Binary trace of a simulation, for tools that analyze it without parsing the diagram. All the numbers are little
+// endian and the layout does not depend on the compiler, so the file can be mapped in memory and read in place:
+//
+// - A traceHeader at offset 0.
+// - recordCnt traceRecords of recordSize bytes from recordOffset, in the order in which their cycles happened.
+// - The text of every instruction of the code from textOffset, ended by a null character each, in code order.
+//
+// The counts in the header are written once the simulation finishes, so they are 0 if it was interrupted. The
+// records that were written can still be read, since there are as many as fit in the rest of the file.
+static constexpr char traceMagic[8] = "MIPSTRC";
+static constexpr uint32_t traceVersion = 1;
+
+// Converts a number between the byte order of the host and the little endian order of the file, in either direction.
+template <integral T> constexpr T littleEndian(T value)
+{
+	if constexpr (endian::native == endian::big) return byteswap(value);
+	else return value;
+}
+
+class traceHeader
+{
+  public:
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t codeCnt; // Instructions in the code, which indices in records refer to.
+	uint8_t forwarding; // Same values as simulator::forwardingType.
+	uint8_t branchPred; // Same values as simulator::branchPredType.
+	uint8_t branchInDec;
+	uint8_t reserved;
+	uint64_t recordOffset;
+	uint64_t recordCnt;
+	uint64_t textOffset;
+	uint64_t textSize;
+	uint64_t instrCnt;
+	uint64_t cycles;
+
+	// Converts every number between the order of the host and the one of the file, in either direction.
+	constexpr void convert()
+	{
+		version = littleEndian(version);
+		recordSize = littleEndian(recordSize);
+		codeCnt = littleEndian(codeCnt);
+		recordOffset = littleEndian(recordOffset);
+		recordCnt = littleEndian(recordCnt);
+		textOffset = littleEndian(textOffset);
+		textSize = littleEndian(textSize);
+		instrCnt = littleEndian(instrCnt);
+		cycles = littleEndian(cycles);
+	}
+};
+
+static_assert(sizeof(traceHeader) == 72);
+
+// Loads and stores are also instructions, with the address they access.
+enum struct traceKind : uint8_t { INSTR = 0, STALL, LOAD, STORE };
+
+enum struct traceBranch : uint8_t { NONE = 0, NOT_TAKEN, TAKEN };
+
+// An instruction that entered the execution phase or a cycle in which none did. Cycles in which the pipeline was
+// still empty at the start or already draining at the end are not recorded.
+class traceRecord
+{
+  public:
+	traceKind kind;
+	uint8_t stall; // Same values as simulator::stallType, NONE for instructions.
+	traceBranch branch;
+	uint8_t penalty; // Cycles without fetching after a branch or a jump.
+	int32_t idx; // Index in code of the instruction or, for stalls, the one that caused it. -1 if unknown.
+	uint32_t fetch;
+	uint32_t decode;
+	uint32_t execute; // Also the cycle of a stall.
+	uint32_t memory;
+	uint32_t writeback;
+	uint32_t address; // Address accessed by a load or a store, 0 for the rest.
+
+	// Converts every number between the order of the host and the one of the file, in either direction.
+	constexpr void convert()
+	{
+		idx = littleEndian(idx);
+		fetch = littleEndian(fetch);
+		decode = littleEndian(decode);
+		execute = littleEndian(execute);
+		memory = littleEndian(memory);
+		writeback = littleEndian(writeback);
+		address = littleEndian(address);
+	}
+};
+
+static_assert(sizeof(traceRecord) == 32);
+
+// Writes the trace of a simulation while it runs.
+class traceWriter
+{
+	ofstream file;
+	parallel::asyncWriter writer;
+
+	span<const simulator::decodedInstr> code;
+
+	traceHeader header = {}; // In the order of the host.
+	vector<traceRecord> stalls; // Not written until an instruction comes after them, already in the order of the file.
+
+	// Writes the header at the current position of the file.
+	void writeHeader();
+
+  public:
+	// Starts the trace of a simulation of the program. Whether the file could be opened is checked through isOpen.
+	traceWriter(const string &path, const simulator::program &prog, simulator::forwardingType forwarding,
+				simulator::branchPredType branchPred, bool branchInDec);
+
+	bool isOpen() const;
+
+	// Adds an instruction once it enters the execution phase, with the address it accesses if it is a load or a
+	// store, as recorded by the interpreter when it executed it.
+	void addInstr(const simulator::timing &t, uint address);
+
+	// Adds a cycle in which no instruction entered the execution phase, with the instruction that caused it.
+	void addStall(simulator::stallType type, int idx, uint cycle);
+
+	// Writes the texts of the instructions and the header. Returns false if the file could not be written and prints
+	// an error to the stream.
+	bool finish(vector<simulator::instruction> &codeText, const string &path, ostream &err);
+};
+} // namespace renderer
@@ -1,6 +1,11 @@
+#pragma once
+
 #include "parseraux.h"
 #include "simulator.h"
+#include <istream>
 #include <ostream>
+#include <string_view>
+#include <unordered_map>
 
 using namespace parser;
 
@@ -16,4 +21,20 @@ bool toVarDef(instruction &instr, simulator::varDef &outRes, ostream &err);
 // Verifies that the instruction is correct and translates it to a more usable format.
 // Returns false if verification was not successful and prints an error to the stream.
 bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &err);
+
+// Lowers the instruction to the compact format used for execution, resolving its label operand.
+// Returns false if the label operand does not exist and prints an error to the stream.
+bool toDecoded(simulator::instruction &instr, unordered_map<string, int> &labelMap, simulator::decodedInstr &outRes,
+			   ostream &err);
+
+// Translates all the parsed instructions of a program, placing its variables in memory and resolving its labels.
+// Returns false if it is not correct and prints an error to the stream.
+bool translateProgram(vector<instruction> &instrs, simulator::program &outRes, ostream &err);
+
+// Parses and translates a whole program. Returns false if it is not correct and prints an error to the stream.
+// The parser is global, so it must not be called from more than one thread at the same time.
+bool loadProgram(istream &in, simulator::program &outRes, ostream &err);
+
+// Same as above, but tokenizing a source that is already in memory in place. It can be called from several threads.
+bool loadProgram(string_view source, simulator::program &outRes, ostream &err);
 } // namespace translator
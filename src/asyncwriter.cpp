@@ -0,0 +1,106 @@
+#include "asyncwriter.h"
+
+namespace parallel
+{
+asyncWriter::asyncWriter(ostream &stream) : stream(stream), target(stream.rdbuf()), current(0)
+{
+	for (uint i = 0; i < blockCnt; i++)
+		blocks.push_back(make_unique<char[]>(blockSize));
+
+	for (uint i = 1; i < blockCnt; i++)
+		freeBlocks.push_back(i);
+
+	setp(blocks[current].get(), blocks[current].get() + blockSize);
+	writer = thread(&asyncWriter::write, this);
+	stream.rdbuf(this);
+}
+
+asyncWriter::~asyncWriter()
+{
+	close();
+}
+
+void asyncWriter::handOver()
+{
+	unique_lock guard(lock);
+	fullBlocks.push_back({current, pptr() - pbase()});
+	changed.notify_all();
+
+	changed.wait(guard, [this] { return !freeBlocks.empty(); });
+	current = freeBlocks.front();
+	freeBlocks.pop_front();
+
+	setp(blocks[current].get(), blocks[current].get() + blockSize);
+}
+
+void asyncWriter::write()
+{
+	while (true) {
+		pair<uint, size_t> block;
+
+		{
+			unique_lock guard(lock);
+			changed.wait(guard, [this] { return closing || !fullBlocks.empty(); });
+
+			if (fullBlocks.empty()) return;
+			block = fullBlocks.front();
+			fullBlocks.pop_front();
+		}
+
+		streamsize size = block.second;
+		if (target->sputn(blocks[block.first].get(), size) != size) failed = true;
+
+		bool caughtUp;
+		{
+			lock_guard guard(lock);
+			freeBlocks.push_back(block.first);
+			caughtUp = fullBlocks.empty();
+			changed.notify_all();
+		}
+
+		// The buffer of the stream may keep the end of a short block, such as one handed over when flushing.
+		if (caughtUp && target->pubsync() != 0) failed = true;
+	}
+}
+
+asyncWriter::int_type asyncWriter::overflow(int_type ch)
+{
+	if (failed) return traits_type::eof();
+
+	handOver();
+
+	if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+
+	*pptr() = traits_type::to_char_type(ch);
+	pbump(1);
+	return ch;
+}
+
+int asyncWriter::sync()
+{
+	if (failed) return -1;
+
+	if (pptr() > pbase()) handOver();
+	return 0;
+}
+
+bool asyncWriter::close()
+{
+	if (!writer.joinable()) return !failed;
+
+	{
+		lock_guard guard(lock);
+		if (pptr() > pbase()) fullBlocks.push_back({current, pptr() - pbase()});
+		closing = true;
+	}
+
+	changed.notify_all();
+	writer.join();
+
+	setp(nullptr, nullptr);
+	stream.rdbuf(target);
+
+	if (target->pubsync() != 0) failed = true;
+	return !failed;
+}
+} // namespace parallel
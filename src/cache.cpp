@@ -0,0 +1,105 @@
+#include "cache.h"
+#include <bit>
+#include <cstring>
+
+namespace simulator
+{
+dataCache::dataCache(const cacheConfig &config)
+	: config(config), lineBits(countr_zero(config.lineSize)), setMask(0)
+{
+	if (!enabled()) return;
+
+	uint entries = config.size / config.lineSize;
+	setMask = entries / config.ways - 1;
+
+	lines.assign(entries, UINT32_MAX);
+	stamps.assign(entries, 0);
+	dirty.assign(entries, 0);
+}
+
+uint dataCache::victim(uint first)
+{
+	uint best = first;
+
+	for (uint w = first; w < first + config.ways; w++) {
+		if (lines[w] == UINT32_MAX) return w;
+		if (stamps[w] < stamps[best]) best = w;
+	}
+
+	if (config.replacement != replacementType::RANDOM) return best;
+
+	random ^= random << 13;
+	random ^= random >> 17;
+	random ^= random << 5;
+	return first + (random & (config.ways - 1));
+}
+
+uint dataCache::access(uint address, bool store)
+{
+	uint line = address >> lineBits;
+	uint first = (line & setMask) * config.ways;
+	clock++;
+
+	if (store) stats.stores++;
+	else stats.loads++;
+
+	for (uint w = first; w < first + config.ways; w++) {
+		if (lines[w] != line) continue;
+
+		if (config.replacement == replacementType::LRU) stamps[w] = clock;
+		if (store && config.write == writePolicy::BACK) dirty[w] = 1;
+		return 0;
+	}
+
+	if (store) stats.storeMisses++;
+	else stats.loadMisses++;
+
+	if (store && config.write == writePolicy::THROUGH) return 0;
+
+	uint w = victim(first);
+	if (dirty[w]) stats.writebacks++;
+
+	lines[w] = line;
+	stamps[w] = clock;
+	dirty[w] = store && config.write == writePolicy::BACK;
+	return config.missPenalty;
+}
+
+const cacheStats &dataCache::getStats() const
+{
+	return stats;
+}
+
+void dataCache::save(ostream &out) const
+{
+	out.write((const char *)&clock, sizeof(clock));
+	out.write((const char *)&random, sizeof(random));
+	out.write((const char *)&stats, sizeof(stats));
+	out.write((const char *)lines.data(), lines.size() * sizeof(uint));
+	out.write((const char *)stamps.data(), stamps.size() * sizeof(uint64_t));
+	out.write((const char *)dirty.data(), dirty.size());
+}
+
+bool dataCache::load(string_view &data)
+{
+	size_t entries = lines.size();
+	size_t size = sizeof(clock) + sizeof(random) + sizeof(stats) + entries * (sizeof(uint) + sizeof(uint64_t) + 1);
+	if (data.size() < size) return false;
+
+	const char *next = data.data();
+	auto read = [&next](void *to, size_t bytes) {
+		memcpy(to, next, bytes);
+		next += bytes;
+	};
+
+	read(&clock, sizeof(clock));
+	read(&random, sizeof(random));
+	read(&stats, sizeof(stats));
+	read(lines.data(), entries * sizeof(uint));
+	read(stamps.data(), entries * sizeof(uint64_t));
+	read(dirty.data(), entries);
+
+	data.remove_prefix(size);
+	return true;
+}
+} // namespace simulator
@@ -0,0 +1,198 @@
+#include "checkpoint.h"
+#include "mappedparser.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace runner
+{
+// The state is saved as it is in memory, so files are only valid for the build that wrote them, which is checked
+// through its size. The version must change with any change of the format.
+static constexpr char magic[8] = "MIPSCKP";
+static constexpr uint32_t version = 6;
+
+// Only the pages of memory that were allocated are saved. Their numbers come right after the state, and their
+// contents start at a page boundary, in the same order, so that they can be used in place once mapped. The tables of
+// the pipeline take the rest of the file.
+static constexpr uint32_t memAlign = simulator::memory::pageSize;
+
+class fileHeader
+{
+  public:
+	char magic[8];
+	uint32_t version;
+	uint32_t stateSize;
+	uint32_t pageCnt;
+	uint32_t memOffset;
+};
+
+// FNV-1a of the compact instructions, which have no padding.
+static uint64_t hashCode(span<const simulator::decodedInstr> code)
+{
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char *bytes = (const unsigned char *)code.data();
+
+	for (size_t i = 0; i < code.size() * sizeof(simulator::decodedInstr); i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+	return hash;
+}
+
+checkpoint makeCheckpoint(const simulator::program &prog, const settings &set, const simulator::pipeline &pipeline,
+						  const renderer::diagram &diagram, const result &res)
+{
+	checkpoint state = {.codeHash = hashCode(prog.code),
+						.codeCnt = (uint)prog.code.size(),
+						.forwarding = set.forwarding,
+						.branchPred = set.branchPred,
+						.branchInDec = set.branchInDec,
+						.predictor = set.predictor,
+						.cache = set.cache,
+						.pipeline = pipeline.getState(),
+						.diagram = diagram.getState(),
+						.instrCnt = res.instrCnt,
+						.cycles = res.cycles};
+
+	memcpy(state.regs, prog.regs, sizeof(state.regs));
+	return state;
+}
+
+bool saveCheckpoint(const string &path, const checkpoint &state, const simulator::program &prog,
+					const simulator::pipeline &pipeline, ostream &err)
+{
+	fileHeader header = {};
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.stateSize = sizeof(checkpoint);
+
+	const simulator::memory &mem = prog.dataMem;
+	header.pageCnt = mem.pageCnt();
+
+	uint64_t listEnd = sizeof(header) + sizeof(checkpoint) + (uint64_t)header.pageCnt * sizeof(uint32_t);
+	header.memOffset = (listEnd + memAlign - 1) / memAlign * memAlign;
+
+	string tmpPath = path + ".tmp";
+
+	{
+		ofstream out(tmpPath, ios::binary);
+		if (!out.is_open()) {
+			err << "Error: File " << tmpPath << " could not be opened for writing." << endl;
+			return false;
+		}
+
+		static const char padding[memAlign] = {};
+		out.write((const char *)&header, sizeof(header));
+		out.write((const char *)&state, sizeof(state));
+
+		for (uint i = 0; i < header.pageCnt; i++) {
+			uint32_t number = mem.pageNumber(i);
+			out.write((const char *)&number, sizeof(number));
+		}
+
+		out.write(padding, header.memOffset - listEnd);
+
+		for (uint i = 0; i < header.pageCnt; i++)
+			out.write(mem.pageData(i), memAlign);
+
+		pipeline.saveTables(out);
+
+		if (!out.good()) {
+			err << "Error: File " << tmpPath << " could not be written." << endl;
+			return false;
+		}
+	}
+
+	error_code error;
+	filesystem::rename(tmpPath, path, error);
+
+	if (error) {
+		err << "Error: File " << path << " could not be replaced: " << error.message() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Indices of instructions must be inside the code, since the file is not trusted.
+static bool isValid(const checkpoint &state)
+{
+	auto isIdx = [&state](int idx) -> bool { return idx >= -1 && idx < (int)state.codeCnt; };
+
+	const simulator::pipelineState &pip = state.pipeline;
+	if (!isIdx(pip.ifLatch.idx) || !isIdx(pip.idLatch.idx) || !isIdx(pip.exLatch.idx) || !isIdx(pip.memLatch.idx) ||
+		!isIdx(pip.wbLatch.idx) || !isIdx(pip.controlIdx) || pip.pc > state.codeCnt ||
+		pip.pendingCnt > simulator::pipelineState::maxPending || pip.stall > simulator::stallType::MEMORY)
+		return false;
+
+	for (uint i = 0; i < pip.pendingCnt; i++) {
+		if (pip.pending[i] < 0 || !isIdx(pip.pending[i])) return false;
+	}
+
+	return true;
+}
+
+bool loadCheckpoint(const string &path, const settings &set, simulator::program &prog, simulator::pipeline &pipeline,
+					checkpoint &outRes, ostream &err)
+{
+	parser::mappedFile mapped;
+	if (!mapped.open(path)) {
+		err << "Error: File " << path << " does not exist or cannot be opened." << endl;
+		return false;
+	}
+
+	string_view file = mapped.text();
+	fileHeader header;
+
+	bool correct = file.size() >= sizeof(header) + sizeof(checkpoint);
+	if (correct) {
+		memcpy(&header, file.data(), sizeof(header));
+		memcpy(&outRes, file.data() + sizeof(header), sizeof(checkpoint));
+
+		uint64_t listEnd = sizeof(header) + sizeof(checkpoint) + (uint64_t)header.pageCnt * sizeof(uint32_t);
+
+		correct = memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version &&
+				  header.stateSize == sizeof(checkpoint) && header.memOffset >= listEnd &&
+				  header.memOffset + (uint64_t)header.pageCnt * memAlign <= file.size() && isValid(outRes);
+	}
+
+	if (!correct) {
+		err << "Error: File " << path << " is not a checkpoint or was written by a different version." << endl;
+		return false;
+	}
+
+	if (outRes.codeHash != hashCode(prog.code) || outRes.codeCnt != prog.code.size()) {
+		err << "Error: Checkpoint " << path << " belongs to a different program." << endl;
+		return false;
+	}
+
+	if (outRes.forwarding != set.forwarding || outRes.branchPred != set.branchPred ||
+		outRes.branchInDec != set.branchInDec || outRes.predictor != set.predictor || outRes.cache != set.cache) {
+		err << "Error: Checkpoint " << path << " was made with different forwarding, branch or cache options." << endl;
+		return false;
+	}
+
+	memcpy(prog.regs, outRes.regs, sizeof(prog.regs));
+	const char *numbers = file.data() + sizeof(header) + sizeof(checkpoint);
+
+	for (uint i = 0; i < header.pageCnt; i++) {
+		uint32_t number;
+		memcpy(&number, numbers + i * sizeof(number), sizeof(number));
+
+		// Numbers out of the address space are from a damaged file, which is otherwise harmless to load.
+		if (number >= 1u << (32 - simulator::memory::pageBits)) {
+			err << "Error: File " << path << " is not a checkpoint or was written by a different version." << endl;
+			return false;
+		}
+
+		prog.dataMem.loadPage(number, file.data() + header.memOffset + (uint64_t)i * memAlign);
+	}
+
+	string_view tables = file.substr(header.memOffset + (uint64_t)header.pageCnt * memAlign);
+	if (!pipeline.loadTables(tables) || !tables.empty()) {
+		err << "Error: File " << path << " is not a checkpoint or was written by a different version." << endl;
+		return false;
+	}
+
+	return true;
+}
+} // namespace runner
@@ -0,0 +1,605 @@
+#include "interpreter.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+
+#if !WINNT
+#include <csetjmp>
+#include <csignal>
+#endif
+
+namespace simulator
+{
+// Mapped memory, accessed without any checks.
+class mappedView
+{
+	char *data;
+
+  public:
+	mappedView(char *data) : data(data) {}
+
+	template <integral T> inline T load(uint idx)
+	{
+		return *(T *)(data + idx);
+	}
+
+	template <integral T> inline void store(uint idx, T value)
+	{
+		*(T *)(data + idx) = value;
+	}
+};
+
+// Memory that is not mapped, so that its accesses skip that check.
+class pagedView
+{
+	memory &mem;
+
+  public:
+	pagedView(memory &mem) : mem(mem) {}
+
+	template <integral T> inline T load(uint idx)
+	{
+		return mem.loadPaged<T>(idx);
+	}
+
+	template <integral T> inline void store(uint idx, T value)
+	{
+		mem.storePaged<T>(idx, value);
+	}
+};
+
+// Index in code of the last load or store of a mapped memory executed by this thread. It is written before every
+// access, since the dispatches keep the program counter in a register that is lost when a fault jumps out of them.
+// The fence keeps the compiler from moving the write after the access, which it does not expect to fault.
+static thread_local uint accessInstr;
+
+static inline void beforeAccess(mappedView &, uint pc)
+{
+	accessInstr = pc;
+	atomic_signal_fence(memory_order_seq_cst);
+}
+
+// Paged memories never fault.
+static inline void beforeAccess(pagedView &, uint) {}
+
+static inline void beforeAccess(memory &m, uint pc)
+{
+	if (m.mappedData() == nullptr) return;
+
+	accessInstr = pc;
+	atomic_signal_fence(memory_order_seq_cst);
+}
+
+#if !WINNT
+// Where the interpreter running in this thread resumes after a fault and the memory it uses.
+static thread_local sigjmp_buf *recovery = nullptr;
+static thread_local const char *faultBase = nullptr;
+static thread_local uint faultAddress;
+
+static void onFault(int, siginfo_t *info, void *)
+{
+	const char *addr = (const char *)info->si_addr;
+
+	if (recovery == nullptr || addr < faultBase || addr >= faultBase + ((uint64_t)1 << 32) + memory::pageSize) {
+		// Not caused by a program, so it crashes as usual when the access is repeated.
+		signal(SIGSEGV, SIG_DFL);
+		return;
+	}
+
+	faultAddress = addr - faultBase;
+	siglongjmp(*recovery, 1);
+}
+
+static bool installFaultHandler()
+{
+	struct sigaction action = {};
+	action.sa_sigaction = onFault;
+	action.sa_flags = SA_SIGINFO | SA_NODEFER; // Not blocked after jumping out of it, so it can fault again.
+	sigemptyset(&action.sa_mask);
+	return sigaction(SIGSEGV, &action, nullptr) == 0;
+}
+#endif
+
+#define INTERPRETER_HANDLER(name, body)                                                                                \
+	static void exec##name([[maybe_unused]] const threadedInstr &i, [[maybe_unused]] memory &m,                        \
+						   [[maybe_unused]] int r[], uint &p)                                                          \
+	{                                                                                                                  \
+		body;                                                                                                          \
+	}
+INTERPRETER_OPERATIONS(INTERPRETER_HANDLER)
+#undef INTERPRETER_HANDLER
+
+#define INTERPRETER_FUSED_HANDLER(name, body)                                                                          \
+	static void exec##name(const threadedInstr &i, [[maybe_unused]] memory &m, int r[], uint &p)                       \
+	{                                                                                                                  \
+		const threadedInstr &j = (&i)[1];                                                                              \
+		body;                                                                                                          \
+	}
+INTERPRETER_FUSED_OPERATIONS(INTERPRETER_FUSED_HANDLER)
+#undef INTERPRETER_FUSED_HANDLER
+
+#define INTERPRETER_HANDLER_PTR(name, body) exec##name,
+static const handler handlers[] = {INTERPRETER_OPERATIONS(INTERPRETER_HANDLER_PTR)
+									   INTERPRETER_FUSED_OPERATIONS(INTERPRETER_HANDLER_PTR)};
+#undef INTERPRETER_HANDLER_PTR
+
+static bool isControl(const decodedInstr &instr)
+{
+	return instr.type == instrType::BRA1 || instr.type == instrType::BRA2 || instr.type == instrType::J;
+}
+
+// Finds the operation that executes both instructions at once or returns NOP if there is none.
+static opcode fuseOpcodes(opcode first, opcode second)
+{
+	if (second != opcode::BEQ && second != opcode::BNE) return opcode::NOP;
+
+	bool eq = second == opcode::BEQ;
+
+	switch (first) {
+		case opcode::ADD:
+			return eq ? opcode::ADD_BEQ : opcode::ADD_BNE;
+		case opcode::ADDI:
+			return eq ? opcode::ADDI_BEQ : opcode::ADDI_BNE;
+		case opcode::SUB:
+			return eq ? opcode::SUB_BEQ : opcode::SUB_BNE;
+		default:
+			return opcode::NOP;
+	}
+}
+
+// Finds the operation that executes the instruction.
+static opcode bindOpcode(const decodedInstr &instr)
+{
+	bool isUnsigned = (char)instr.flags.mod & (char)opMod::UNSIGNED;
+
+	switch (instr.type) {
+		case instrType::R3:
+			switch (instr.op) {
+				case operation::ADD:
+					return isUnsigned ? opcode::ADDU : opcode::ADD;
+				case operation::AND:
+					return opcode::AND;
+				case operation::NOR:
+					return opcode::NOR;
+				case operation::OR:
+					return opcode::OR;
+				case operation::SUB:
+					return isUnsigned ? opcode::SUBU : opcode::SUB;
+				case operation::XOR:
+					return opcode::XOR;
+				default:
+					return opcode::NOP;
+			}
+
+		case instrType::R2:
+			switch (instr.op) {
+				case operation::ADD:
+					return isUnsigned ? opcode::ADDIU : opcode::ADDI;
+				case operation::AND:
+					return opcode::ANDI;
+				case operation::NOR:
+					return opcode::NORI;
+				case operation::OR:
+					return opcode::ORI;
+				case operation::XOR:
+					return opcode::XORI;
+				default:
+					return opcode::NOP;
+			}
+
+		case instrType::MEM: {
+			bool store = instr.op == operation::S;
+
+			switch (instr.flags.size) {
+				case dataSize::BYTE:
+					return store ? opcode::SB : opcode::LB;
+				case dataSize::HALF:
+					return store ? opcode::SH : opcode::LH;
+				default:
+					return store ? opcode::SW : opcode::LW;
+			}
+		}
+
+		case instrType::BRA2:
+			return instr.op == operation::EQ ? opcode::BEQ : opcode::BNE;
+
+		case instrType::BRA1:
+			switch (instr.op) {
+				case operation::GEZ:
+					return opcode::BGEZ;
+				case operation::GTZ:
+					return opcode::BGTZ;
+				case operation::LEZ:
+					return opcode::BLEZ;
+				default:
+					return opcode::BLTZ;
+			}
+
+		case instrType::J:
+			return opcode::J;
+
+		default: // NOPs and errors
+			return opcode::NOP;
+	}
+}
+
+interpreter::interpreter(span<const decodedInstr> code, memory &mem, int regs[], dispatchType dispatch)
+	: code(code), mem(mem), regs(regs), dispatch(dispatch)
+{
+	if (dispatch == dispatchType::SWITCH) return;
+
+	bound.reserve(code.size());
+
+	for (const decodedInstr &instr : code) {
+		opcode op = bindOpcode(instr);
+
+		bound.push_back({.run = handlers[(int)op],
+						 .code = op,
+						 .rS = instr.rS,
+						 .rT = instr.rT,
+						 .rD = instr.rD,
+						 .im = instr.im,
+						 .target = instr.target});
+	}
+
+	if (dispatch != dispatchType::BLOCK) return;
+
+	// Blocks start at the beginning, at the targets of branches and jumps and after them.
+	leaders.assign(code.size(), false);
+	blockAt.assign(code.size(), -1);
+
+	if (!code.empty()) leaders[0] = true;
+
+	for (uint idx = 0; idx < code.size(); idx++) {
+		if (!isControl(code[idx])) continue;
+
+		if (code[idx].target >= 0) leaders[code[idx].target] = true;
+		if (idx + 1 < code.size()) leaders[idx + 1] = true;
+	}
+}
+
+template <class F> uint interpreter::guard(uint &pc, F run)
+{
+#if WINNT
+	return run();
+#else
+	if (mem.mappedData() == nullptr) return run();
+
+	static bool installed = installFaultHandler();
+	if (!installed) return run();
+
+	sigjmp_buf point;
+	recovery = &point;
+	faultBase = mem.mappedData();
+
+	if (sigsetjmp(point, 0) != 0) {
+		recovery = nullptr;
+		faulted = true;
+		fault = {.address = faultAddress, .instr = (int)accessInstr};
+		pc = code.size();
+		return 0;
+	}
+
+	uint executed = run();
+	recovery = nullptr;
+	return executed;
+#endif
+}
+
+uint interpreter::run(uint &pc, uint count, int trace[])
+{
+	return guard(pc, [&] {
+		if (dispatch == dispatchType::THREADED) {
+			if (mem.mappedData() != nullptr) {
+				mappedView view(mem.mappedData());
+				return runThreaded(view, pc, count, trace);
+			}
+
+			pagedView view(mem);
+			return runThreaded(view, pc, count, trace);
+		}
+
+		if (dispatch == dispatchType::BLOCK) return runBlocks(pc, count, trace);
+		return runSwitch(pc, count, trace);
+	});
+}
+
+uint interpreter::runSwitch(uint &pc, uint count, int trace[])
+{
+	uint executed = 0;
+
+	for (; executed < count && pc < code.size(); executed++) {
+		if (trace) trace[executed] = pc;
+
+		const decodedInstr &instr = code[pc];
+		if (instr.type == instrType::MEM) beforeAccess(mem, pc);
+
+		instr.execute(mem, regs, pc);
+		pc++;
+	}
+
+	return executed;
+}
+
+uint interpreter::runWithAddresses(uint &pc, uint count, int trace[], uint addresses[])
+{
+	return guard(pc, [&] {
+		uint executed = 0;
+
+		for (; executed < count && pc < code.size(); executed++) {
+			const decodedInstr &instr = code[pc];
+			trace[executed] = pc;
+
+			if (instr.type == instrType::MEM) {
+				addresses[executed] = regs[(int)instr.rS] + instr.im;
+				beforeAccess(mem, pc);
+			}
+
+			instr.execute(mem, regs, pc);
+			pc++;
+		}
+
+		return executed;
+	});
+}
+
+template <class M> uint interpreter::runThreaded(M &m, uint &pc, uint count, int trace[])
+{
+	const threadedInstr *prog = bound.data();
+	uint size = bound.size();
+	uint executed = 0;
+
+	// Local copies so that they can be kept in registers.
+	uint p = pc;
+	int *r = regs;
+
+#if defined(__GNUC__) // Computed goto, supported by GCC and Clang.
+#define INTERPRETER_LABEL_PTR(name, body) &&label##name,
+	static void *labels[] = {INTERPRETER_OPERATIONS(INTERPRETER_LABEL_PTR)};
+#undef INTERPRETER_LABEL_PTR
+
+#define INTERPRETER_DISPATCH()                                                                                         \
+	if (executed == count || p >= size) goto done;                                                                    \
+	if (trace) trace[executed] = p;                                                                                    \
+	executed++;                                                                                                        \
+	goto *labels[(int)prog[p].code];
+
+	INTERPRETER_DISPATCH();
+
+#define INTERPRETER_LABEL(name, body)                                                                                  \
+	label##name:                                                                                                       \
+	{                                                                                                                  \
+		[[maybe_unused]] const threadedInstr &i = prog[p];                                                             \
+		body;                                                                                                          \
+	}                                                                                                                  \
+	INTERPRETER_DISPATCH();
+	INTERPRETER_OPERATIONS(INTERPRETER_LABEL)
+#undef INTERPRETER_LABEL
+#undef INTERPRETER_DISPATCH
+
+done:
+#else
+	for (; executed < count && p < size; executed++) {
+		if (trace) trace[executed] = p;
+
+		const threadedInstr &i = prog[p];
+		i.run(i, mem, r, p);
+	}
+#endif
+
+	pc = p;
+	return executed;
+}
+
+const basicBlock &interpreter::getBlock(uint start)
+{
+	if (blockAt[start] >= 0) return blocks[blockAt[start]];
+
+	basicBlock block = {.first = (uint)blockOps.size(), .instrCnt = 0};
+
+	for (uint idx = start; idx < code.size();) {
+		bool control = isControl(code[idx]);
+
+		// The second instruction of a pair can't be a leader, or jumping to it would skip the first one.
+		if (!control && idx + 1 < code.size() && !leaders[idx + 1] && isControl(code[idx + 1])) {
+			opcode fused = fuseOpcodes(bound[idx].code, bound[idx + 1].code);
+
+			if (fused != opcode::NOP) {
+				threadedInstr first = bound[idx];
+				first.run = handlers[(int)fused];
+				first.code = fused;
+
+				blockOps.push_back(first);
+				blockOps.push_back(bound[idx + 1]);
+				block.instrCnt += 2;
+				break;
+			}
+		}
+
+		blockOps.push_back(bound[idx]);
+		block.instrCnt++;
+		idx++;
+
+		if (control || idx >= code.size() || leaders[idx]) break;
+	}
+
+	// Marks the end of the block, so that the operations don't need to check for it.
+	blockOps.push_back({.run = nullptr, .code = opcode::BLOCK_END});
+
+	blockAt[start] = blocks.size();
+	blocks.push_back(block);
+	return blocks.back();
+}
+
+uint interpreter::runBlocks(uint &pc, uint count, int trace[])
+{
+	if (mem.mappedData() != nullptr) {
+		mappedView view(mem.mappedData());
+		return runBlocks(view, pc, count, trace);
+	}
+
+	pagedView view(mem);
+	return runBlocks(view, pc, count, trace);
+}
+
+template <class M> uint interpreter::runBlocks(M &m, uint &pc, uint count, int trace[])
+{
+	uint size = code.size();
+	uint executed = 0;
+
+	uint p = pc;
+	int *r = regs;
+
+	const threadedInstr *ip;
+
+#if defined(__GNUC__)
+	uint blockStart = UINT_MAX, blockInstrs = 0;
+	const threadedInstr *blockOps0 = nullptr;
+
+#define INTERPRETER_LABEL_PTR(name, body) &&label##name,
+	static void *labels[] = {INTERPRETER_OPERATIONS(INTERPRETER_LABEL_PTR)
+								 INTERPRETER_FUSED_OPERATIONS(INTERPRETER_LABEL_PTR) &&labelBLOCK_END};
+#undef INTERPRETER_LABEL_PTR
+
+	goto labelBLOCK_END;
+
+#define INTERPRETER_LABEL(name, body)                                                                                  \
+	label##name:                                                                                                       \
+	{                                                                                                                  \
+		[[maybe_unused]] const threadedInstr &i = *ip;                                                                 \
+		body;                                                                                                          \
+	}                                                                                                                  \
+	goto *labels[(int)(++ip)->code];
+	INTERPRETER_OPERATIONS(INTERPRETER_LABEL)
+#undef INTERPRETER_LABEL
+
+#define INTERPRETER_FUSED_LABEL(name, body)                                                                            \
+	label##name:                                                                                                       \
+	{                                                                                                                  \
+		const threadedInstr &i = ip[0], &j = ip[1];                                                                    \
+		body;                                                                                                          \
+	}                                                                                                                  \
+	goto *labels[(int)(ip += 2)->code];
+	INTERPRETER_FUSED_OPERATIONS(INTERPRETER_FUSED_LABEL)
+#undef INTERPRETER_FUSED_LABEL
+
+labelBLOCK_END:
+	// Loops usually jump back to the block that just ended, which is then reused without looking it up.
+	if (p != blockStart) {
+		if (p >= size) goto done;
+
+		const basicBlock &block = blockAt[p] >= 0 ? blocks[blockAt[p]] : getBlock(p);
+		blockStart = p;
+		blockOps0 = blockOps.data() + block.first;
+		blockInstrs = block.instrCnt;
+	}
+
+	// Blocks that don't fit are left to the threaded dispatch, which can stop at any instruction.
+	if (blockInstrs > count - executed) goto done;
+
+	if (trace) {
+		for (uint k = 0; k < blockInstrs; k++)
+			trace[executed + k] = p + k;
+	}
+	executed += blockInstrs;
+
+	ip = blockOps0;
+	goto *labels[(int)ip->code];
+
+done:
+#else
+	while (p < size) {
+		const basicBlock &block = getBlock(p);
+		if (block.instrCnt > count - executed) break;
+
+		if (trace) {
+			for (uint k = 0; k < block.instrCnt; k++)
+				trace[executed + k] = p + k;
+		}
+		executed += block.instrCnt;
+
+		// Fused operations take two positions.
+		for (ip = blockOps.data() + block.first; ip->code != opcode::BLOCK_END; ip += ip->code > opcode::J ? 2 : 1)
+			ip->run(*ip, mem, r, p);
+	}
+#endif
+
+	pc = p;
+
+	if (executed < count && p < size)
+		executed += runThreaded(m, pc, count - executed, trace ? trace + executed : nullptr);
+
+	return executed;
+}
+
+uint interpreter::step(uint &pc, int trace[])
+{
+	if (dispatch != dispatchType::BLOCK || pc >= code.size()) return run(pc, 1, trace);
+
+	uint count = getBlock(pc).instrCnt;
+	return guard(pc, [&] { return runBlocks(pc, count, trace); });
+}
+
+uint interpreter::runUntil(uint &pc, uint target, uint count)
+{
+	uint executed = 0;
+
+	while (executed < count && pc != target && pc < code.size()) {
+		// Whole blocks are executed at once unless the target is inside of them.
+		uint chunk = dispatch == dispatchType::BLOCK ? getBlock(pc).instrCnt : 1;
+		if (pc < target && target < pc + chunk) chunk = target - pc;
+
+		executed += run(pc, min(chunk, count - executed), nullptr);
+	}
+
+	return executed;
+}
+
+bool interpreter::verify(span<const decodedInstr> code, memory mem, int regs[], dispatchType dispatch, uint limit,
+						 ostream &err)
+{
+	memory otherMem = mem;
+	int switchRegs[32], otherRegs[32];
+	copy(regs, regs + 32, switchRegs);
+	copy(regs, regs + 32, otherRegs);
+
+	interpreter switchInterp(code, mem, switchRegs, dispatchType::SWITCH);
+	interpreter otherInterp(code, otherMem, otherRegs, dispatch);
+
+	vector<int> trace(code.size());
+	uint switchPc = 0, otherPc = 0;
+
+	for (uint executed = 0; otherPc < code.size() && executed <= limit;) {
+		uint pc = otherPc;
+		uint stepped = otherInterp.step(otherPc, trace.data());
+
+		switchInterp.run(switchPc, stepped, nullptr);
+		executed += stepped;
+
+		if (switchPc != otherPc) {
+			err << "Error: Dispatch mismatch after instruction " << pc << ". Next instruction is " << switchPc
+				<< " instead of " << otherPc << '.' << endl;
+			return false;
+		}
+
+		for (int i = 0; i < 32; i++) {
+			if (switchRegs[i] != otherRegs[i]) {
+				err << "Error: Dispatch mismatch after instruction " << pc << ". Register $" << i << " is "
+					<< switchRegs[i] << " instead of " << otherRegs[i] << '.' << endl;
+				return false;
+			}
+		}
+
+		bool stored = any_of(trace.begin(), trace.begin() + stepped, [&](int idx) {
+			return code[idx].type == instrType::MEM && code[idx].op == operation::S;
+		});
+
+		if (stored && !(mem == otherMem)) {
+			err << "Error: Dispatch mismatch after instruction " << pc << ". Memory contents differ." << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+} // namespace simulator
@@ -1,22 +1,30 @@
-#include "translator.h"
+#include "asyncwriter.h"
+#include "mappedparser.h"
+#include "runner.h"
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <getopt.h>
 #include <iostream>
-#include <unordered_map>
-#include <unordered_set>
+#include <thread>
 #include <vector>
 
 int main(int argc, char *argv[])
 {
 	// Parse arguments
 	ifstream iFile;
+	string iPath;
 	ofstream oFile;
-	bool useRegularNOPs = false;
-	bool branchInDec = false;
-	bool useTabs = false;
-	uint instrLimit = 256; // Instruction limit (to prevent infinite loops)
-	simulator::forwardingType forwarding = simulator::forwardingType::NONE;
-	simulator::branchPredType branchPred = simulator::branchPredType::NONE;
+	string oPath;
+	string batchPath;
+	string loadPath;
+	runner::settings set;
+
+	// Options without a short version.
+	enum longOpt { DISPATCH = 256, SWEEP, BATCH, PARSER, COMPILE, LOAD, CHECKPOINT, CHECKPOINT_EVERY, RESTORE,
+				   SAMPLE, SAMPLE_WINDOW, SAMPLE_WARMUP, SKIP, SKIP_TO, COMPRESS_LOOPS, TRACE, BP_TABLE, BP_HISTORY,
+				   BTB, CACHE, CACHE_LINE, CACHE_WAYS, CACHE_REPLACE, CACHE_WRITE, CACHE_PENALTY, MEMORY, MEMORY_SIZE,
+				   CORES, QUANTUM };
 
 	int opt, optidx = 0;
 	static struct option long_options[] = {{"input", required_argument, nullptr, 'i'},
@@ -25,12 +33,43 @@ int main(int argc, char *argv[])
 										   {"branch-in-dec", no_argument, nullptr, 'd'},
 										   {"unlimited", no_argument, nullptr, 'u'},
 										   {"tabs", no_argument, nullptr, 't'},
+										   {"stats-only", no_argument, nullptr, 's'},
+										   {"compress-loops", no_argument, nullptr, COMPRESS_LOOPS},
 										   {"forwarding", optional_argument, nullptr, 'f'},
 										   {"branch", required_argument, nullptr, 'b'},
+										   {"bp-table", required_argument, nullptr, BP_TABLE},
+										   {"bp-history", required_argument, nullptr, BP_HISTORY},
+										   {"btb", required_argument, nullptr, BTB},
+										   {"cache", required_argument, nullptr, CACHE},
+										   {"cache-line", required_argument, nullptr, CACHE_LINE},
+										   {"cache-ways", required_argument, nullptr, CACHE_WAYS},
+										   {"cache-replace", required_argument, nullptr, CACHE_REPLACE},
+										   {"cache-write", required_argument, nullptr, CACHE_WRITE},
+										   {"cache-penalty", required_argument, nullptr, CACHE_PENALTY},
+										   {"memory", required_argument, nullptr, MEMORY},
+										   {"memory-size", required_argument, nullptr, MEMORY_SIZE},
+										   {"dispatch", required_argument, nullptr, DISPATCH},
+										   {"sweep", no_argument, nullptr, SWEEP},
+										   {"jobs", required_argument, nullptr, 'j'},
+										   {"batch", required_argument, nullptr, BATCH},
+										   {"parser", required_argument, nullptr, PARSER},
+										   {"compile", required_argument, nullptr, COMPILE},
+										   {"load", required_argument, nullptr, LOAD},
+										   {"checkpoint", required_argument, nullptr, CHECKPOINT},
+										   {"checkpoint-every", required_argument, nullptr, CHECKPOINT_EVERY},
+										   {"restore", required_argument, nullptr, RESTORE},
+										   {"sample", required_argument, nullptr, SAMPLE},
+										   {"sample-window", required_argument, nullptr, SAMPLE_WINDOW},
+										   {"sample-warmup", required_argument, nullptr, SAMPLE_WARMUP},
+										   {"skip", required_argument, nullptr, SKIP},
+										   {"skip-to", required_argument, nullptr, SKIP_TO},
+										   {"cores", required_argument, nullptr, CORES},
+										   {"quantum", required_argument, nullptr, QUANTUM},
+										   {"trace", required_argument, nullptr, TRACE},
 										   {"help", no_argument, nullptr, 'h'},
 										   {nullptr, 0, nullptr, 0}};
 
-	while ((opt = getopt_long(argc, argv, "hnutdf::b:i:o:", long_options, &optidx)) != -1) {
+	while ((opt = getopt_long(argc, argv, "hnutsdf::b:i:o:j:", long_options, &optidx)) != -1) {
 		switch (opt) {
 			case 'i':
 				iFile = ifstream(optarg);
@@ -39,39 +78,43 @@ int main(int argc, char *argv[])
 					return -1;
 				}
 
+				iPath = optarg;
 				break;
 
-			case 'o':
-				oFile = ofstream(optarg);
-				if (!oFile.is_open()) {
-					cerr << "Error: File " << optarg << " could not be opened for writing." << endl;
-					return -1;
-				}
-
+			case 'o': // Opened once it is known whether it is a file or a directory.
+				oPath = optarg;
 				break;
 
 			case 'n':
-				useRegularNOPs = true;
+				set.useRegularNOPs = true;
 				break;
 
 			case 'd':
-				branchInDec = true;
+				set.branchInDec = true;
 				break;
 
 			case 't':
-				useTabs = true;
+				set.useTabs = true;
+				break;
+
+			case 's':
+				set.statsOnly = true;
+				break;
+
+			case COMPRESS_LOOPS:
+				set.compressLoops = true;
 				break;
 
 			case 'u':
-				instrLimit = UINT32_MAX;
+				set.instrLimit = UINT32_MAX;
 				break;
 
 			case 'f': {
 				string arg = optarg ? string(optarg) : "";
 				if (arg.empty() || arg == "full") {
-					forwarding = simulator::forwardingType::FULL;
+					set.forwarding = simulator::forwardingType::FULL;
 				} else if (arg == "alu") {
-					forwarding = simulator::forwardingType::ALU;
+					set.forwarding = simulator::forwardingType::ALU;
 				} else if (arg != "no") {
 					cerr << "Error: Unknown forwarding type " << arg << endl;
 					return -1;
@@ -83,11 +126,17 @@ int main(int argc, char *argv[])
 			case 'b': {
 				string arg = string(optarg);
 				if (arg == "p") {
-					branchPred = simulator::branchPredType::PERFECT;
+					set.branchPred = simulator::branchPredType::PERFECT;
 				} else if (arg == "t") {
-					branchPred = simulator::branchPredType::TAKEN;
+					set.branchPred = simulator::branchPredType::TAKEN;
 				} else if (arg == "nt") {
-					branchPred = simulator::branchPredType::NOT_TAKEN;
+					set.branchPred = simulator::branchPredType::NOT_TAKEN;
+				} else if (arg == "1bit") {
+					set.branchPred = simulator::branchPredType::ONE_BIT;
+				} else if (arg == "2bit") {
+					set.branchPred = simulator::branchPredType::TWO_BIT;
+				} else if (arg == "gshare") {
+					set.branchPred = simulator::branchPredType::GSHARE;
 				} else if (arg != "no") {
 					cerr << "Error: Unknown branch prediction type " << arg << endl;
 					return -1;
@@ -96,324 +145,472 @@ int main(int argc, char *argv[])
 				break;
 			}
 
-			case 'h':
-				cout
-					<< "MIPS Pipeline Simulator Options\n"
-					   "\t-i --input [file]\t\tSpecify the input file to read from.\n"
-					   "\t-o --output [file]\t\tSpecify the output file to write to.\n"
-					   "\t-n --nops\t\t\tAdds NOPs to the resulting code rather than printing the diagram.\n"
-					   "\t-d --branch-in-dec\t\tBranch jump address is calculated in the decode phase.\n"
-					   "\t-u --unlimited\t\t\tDisables hard limit on amount of executed instructions.\n"
-					   "\t-t --tabs\t\t\tUse tabs instead of spaces for separating pipeline phases.\n"
-					   "\t-f --forwarding <no|alu|full>\tChoose between the following forwarding options:\n"
-					   "\t\t* no: No forwarding.\n\t\t* alu: Only ALU-ALU (EX to EX) forwarding.\n"
-					   "\t\t* full: Full forwarding.\n"
-					   "\t-b --branch [no|p|t|nt]\t\tChoose between the following branch prediction options:\n"
-					   "\t\t* no: No branch prediction.\n\t\t* p: Perfect branch prediction.\n"
-					   "\t\t* t: Always predict as taken.\n\t\t* nt: Always predict as not taken.\n"
-					   "\nNote that if no input/output file is specified then the standard input/output will be used.\n"
-					   "If the forwarding option (-f) is used but no additional value is passed then full forwarding "
-					   "will be used."
-					<< endl;
-
-				return 0;
-
-			case '?': // getopt_long handles error printing
-				return -1;
-		}
-	}
-
-	if (iFile.is_open()) cin.rdbuf(iFile.rdbuf());
-	if (oFile.is_open()) cout.rdbuf(oFile.rdbuf());
+			case BP_TABLE:
+			case BTB: {
+				// Up to 2^24 entries, which is more than any program needs.
+				string arg = string(optarg);
+				uint size = arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 8
+								? 0
+								: stoul(arg);
 
-	uint line = 0;
+				if ((size & (size - 1)) != 0 || size > 1 << 24 || (opt == BP_TABLE && size == 0)) {
+					cerr << "Error: Invalid amount of entries " << arg << ", it must be a power of two." << endl;
+					return -1;
+				}
 
-	simulator::memory dataMem;
-	int regs[32] = {};
+				(opt == BP_TABLE ? set.predictor.tableSize : set.predictor.btbSize) = size;
+				break;
+			}
 
-	vector<instruction> instrs = parse(&cin);
+			case BP_HISTORY: {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 2 ||
+					stoul(arg) > 24) {
+					cerr << "Error: Invalid amount of history bits " << arg << endl;
+					return -1;
+				}
 
-	// Variable declarations
-	for (; line < instrs.size(); line++) {
-		instruction instr = instrs[line];
-		simulator::varDef varDef;
+				set.predictor.historyBits = stoul(arg);
+				break;
+			}
 
-		if (!translator::isVarDef(instr)) break;
+			case CACHE:
+			case CACHE_LINE:
+			case CACHE_WAYS: {
+				string arg = string(optarg);
+				bool number = !arg.empty() && arg.find_first_not_of("0123456789") == string::npos && arg.size() <= 10;
+				uint64_t size = number ? stoull(arg) : 0;
 
-		if (!translator::toVarDef(instr, varDef, cerr)) {
-			cerr << "Error happened at instruction " << line + 1 << endl;
-			return -1;
-		}
+				if (size == 0 || size > 1u << 30 || (size & (size - 1)) != 0) {
+					cerr << "Error: Invalid size " << arg << ", it must be a power of two." << endl;
+					return -1;
+				}
 
-		regs[varDef.reg] = dataMem.add(varDef);
-	}
+				// Lines of a word at least, so that an aligned word is in a single line and no line has the number of
+				// an empty way.
+				if (opt == CACHE_LINE && size < 4) {
+					cerr << "Error: Invalid line size " << arg << ", it must be at least 4." << endl;
+					return -1;
+				}
 
-	dataMem.shrink();
+				uint &value = opt == CACHE ? set.cache.size : opt == CACHE_LINE ? set.cache.lineSize : set.cache.ways;
+				value = size;
+				break;
+			}
 
-	int codeSize = instrs.size() - line;
-	simulator::instruction code[codeSize];
-	unordered_map<string, int> labelMap;
+			case CACHE_REPLACE: {
+				string arg = string(optarg);
+				if (arg == "fifo") {
+					set.cache.replacement = simulator::replacementType::FIFO;
+				} else if (arg == "random") {
+					set.cache.replacement = simulator::replacementType::RANDOM;
+				} else if (arg != "lru") {
+					cerr << "Error: Unknown replacement policy " << arg << endl;
+					return -1;
+				}
 
-	// Saves in what column the instructions start to be printed.
-	// This is done to align to all labels correctly.
-	uint instrcol = 0;
+				break;
+			}
 
-	// Instructions
-	for (int i = 0; line < instrs.size(); line++, i++) {
-		instruction instr = instrs[line];
-		simulator::instruction instruction;
+			case CACHE_WRITE: {
+				string arg = string(optarg);
+				if (arg == "through") {
+					set.cache.write = simulator::writePolicy::THROUGH;
+				} else if (arg != "back") {
+					cerr << "Error: Unknown write policy " << arg << endl;
+					return -1;
+				}
 
-		if (translator::isVarDef(instr)) {
-			cerr << "Error: Cannot define a variable in execution time. Instruction " << line + 1 << endl;
-			return -1;
-		}
+				break;
+			}
 
-		if (!translator::toInstruction(instr, instruction, cerr)) {
-			cerr << "Error happened at instruction " << line + 1 << endl;
-			return -1;
-		}
+			case CACHE_PENALTY: {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 6) {
+					cerr << "Error: Invalid amount of cycles " << arg << endl;
+					return -1;
+				}
 
-		if (!instruction.label.empty()) {
-			if (labelMap.contains(instruction.label)) {
-				cerr << "Error: cannot have the same label for more than one instruction. Instruction " << line + 1
-					 << " for label " << instruction.label << endl;
-				return -1;
+				set.cache.missPenalty = stoul(arg);
+				break;
 			}
 
-			labelMap[instruction.label] = i;
+			case MEMORY: {
+				string arg = string(optarg);
+				if (arg == "mapped") {
+					set.mapMemory = true;
+				} else if (arg != "paged") {
+					cerr << "Error: Unknown memory type " << arg << endl;
+					return -1;
+				}
 
-			uint labellen = instruction.label.length();
-			if (instrcol < labellen) instrcol = labellen;
-		}
+				break;
+			}
 
-		code[i] = instruction;
-	}
+			case MEMORY_SIZE: {
+				string arg = string(optarg);
+				bool number = !arg.empty() && arg.find_first_not_of("0123456789") == string::npos && arg.size() <= 10;
+				uint64_t size = number ? stoull(arg) : 0;
 
-	freeResources(); // Frees resources from the parser
+				if (!number || size > UINT32_MAX) {
+					cerr << "Error: Invalid memory size " << arg << endl;
+					return -1;
+				}
 
-	// Saves in what column the pipeline diagram will start.
-	// Similar to instrcol, this is done to properly align it in all lines.
-	uint diagramStart = 0;
+				set.memorySize = size;
+				break;
+			}
 
-	if (!useRegularNOPs)
-		for (simulator::instruction instr : code) {
-			uint instrlen = instr.toString(instrcol).length();
-			if (diagramStart < instrlen) diagramStart = instrlen;
-		}
+			case DISPATCH: {
+				string arg = string(optarg);
+				if (arg == "threaded") {
+					set.dispatch = simulator::dispatchType::THREADED;
+				} else if (arg == "block") {
+					set.dispatch = simulator::dispatchType::BLOCK;
+				} else if (arg == "check") {
+					set.dispatch = simulator::dispatchType::BLOCK;
+					set.checkDispatch = true;
+				} else if (arg != "switch") {
+					cerr << "Error: Unknown dispatch type " << arg << endl;
+					return -1;
+				}
 
-	vector<simulator::instruction> executedCode;
+				break;
+			}
 
-	// For each register, stores how many pipeline stages are left before the register's value is available
-	// (either by forwarding or write-back)
-	char regBusy[32] = {};
-	// For each register, stores how many pipeline stages are left before the register's value is written (write-back)
-	char regDirty[32] = {};
+			case SWEEP:
+				set.sweep = true;
+				break;
 
-	// Stores which register was last written. Useful for ALU-ALU forwarding.
-	simulator::reg regLast = -1;
+			case 'j': {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 9) {
+					cerr << "Error: Invalid amount of jobs " << arg << endl;
+					return -1;
+				}
 
-	bool addNOP = false;
+				// More threads than the hardware runs at once would only take turns.
+				uint hardware = thread::hardware_concurrency();
+				set.jobs = hardware > 0 ? min((uint)stoul(arg), hardware) : stoul(arg);
+				break;
+			}
 
-	simulator::instrType nopType = useRegularNOPs ? simulator::instrType::NOP : simulator::instrType::SNOP;
-	simulator::instruction nop = {.displayName = "NOP", .type = nopType, .op = simulator::operation::NONE};
+			case BATCH:
+				batchPath = optarg;
+				break;
 
-	// Execution
-	for (uint pc = 0; pc < codeSize; pc++) {
+			case COMPILE:
+				set.compilePath = optarg;
+				break;
 
-		if (executedCode.size() > instrLimit) {
-			cerr << "Instruction limit reached. Check for infinite loops." << endl;
-			return -1;
-		}
+			case LOAD:
+				loadPath = optarg;
+				break;
 
-		for (int i = 0; i < 32; i++) {
-			if (regBusy[i] > 0) --regBusy[i];
-			if (regDirty[i] > 0) --regDirty[i];
-		}
+			case CHECKPOINT:
+				set.checkpointPath = optarg;
+				break;
 
-		simulator::instruction instr = code[pc];
+			case CHECKPOINT_EVERY: {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 9 ||
+					stoul(arg) == 0) {
+					cerr << "Error: Invalid amount of cycles " << arg << endl;
+					return -1;
+				}
 
-		if (!instr.labelOp.empty()) {
-			if (!labelMap.contains(instr.labelOp)) {
-				cerr << "Error: reference to unknown label " << instr.labelOp << " in instruction " << line + 1 << endl;
-				return -1;
+				set.checkpointEvery = stoul(arg);
+				break;
 			}
-		}
 
-		simulator::pipPhase rSPhase = instr.calcRSNeeded();
-		simulator::pipPhase rTPhase = instr.calcRTNeeded();
+			case RESTORE:
+				set.restorePath = optarg;
+				break;
 
-		switch (forwarding) {
-			case simulator::forwardingType::FULL:
-				if ((char)rSPhase > 0 && instr.rS > 0) addNOP |= regBusy[instr.rS] >= (char)rSPhase;
-				if ((char)rTPhase > 0 && instr.rT > 0) addNOP |= regBusy[instr.rT] >= (char)rTPhase;
+			case TRACE:
+				set.tracePath = optarg;
 				break;
 
-			case simulator::forwardingType::ALU:
+			case SAMPLE:
+			case SAMPLE_WINDOW:
+			case SAMPLE_WARMUP: {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 9 ||
+					(opt != SAMPLE_WARMUP && stoul(arg) == 0)) {
+					cerr << "Error: Invalid amount of instructions " << arg << endl;
+					return -1;
+				}
 
-				if ((char)rSPhase > 0 && instr.rS > 0)
-					addNOP |=
-						regLast == instr.rS ? regBusy[instr.rS] != 2 && regBusy[instr.rS] != 0 : regDirty[instr.rS] > 0;
+				uint &value = opt == SAMPLE		   ? set.samplePeriod
+							  : opt == SAMPLE_WINDOW ? set.sampleWindow
+													 : set.sampleWarmup;
+				value = stoul(arg);
+				break;
+			}
 
-				if ((char)rTPhase > 0 && instr.rT > 0)
-					addNOP |=
-						regLast == instr.rS ? regBusy[instr.rT] != 2 && regBusy[instr.rT] != 0 : regDirty[instr.rT] > 0;
+			case SKIP: {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 9) {
+					cerr << "Error: Invalid amount of instructions " << arg << endl;
+					return -1;
+				}
 
+				set.skipCount = stoul(arg);
 				break;
+			}
 
-			case simulator::forwardingType::NONE:
-				if ((char)rSPhase > 0 && instr.rS > 0) addNOP |= regDirty[instr.rS] > 0;
-				if ((char)rTPhase > 0 && instr.rT > 0) addNOP |= regDirty[instr.rT] > 0;
+			case SKIP_TO:
+				set.skipLabel = optarg;
 				break;
-		}
-
-		regLast = -1;
 
-		if (addNOP) {
-			executedCode.push_back(nop);
-			addNOP = false;
-			--pc;
-			continue;
-		}
+			case CORES: {
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 4 ||
+					stoul(arg) == 0) {
+					cerr << "Error: Invalid amount of cores " << arg << endl;
+					return -1;
+				}
 
-		uint lastpc = pc;
+				set.cores = stoul(arg);
+				break;
+			}
 
-		instr.execute(dataMem, regs, labelMap, pc);
-		executedCode.push_back(instr);
+			case QUANTUM: {
+				// Up to a million, since every core keeps the instructions of a whole quantum until they are simulated.
+				string arg = string(optarg);
+				if (arg.empty() || arg.find_first_not_of("0123456789") != string::npos || arg.size() > 7 ||
+					stoul(arg) == 0 || stoul(arg) > 1000000) {
+					cerr << "Error: Invalid amount of instructions " << arg << endl;
+					return -1;
+				}
 
-		if (instr.type == simulator::instrType::BRA1 || instr.type == simulator::instrType::BRA2) {
-			bool taken = lastpc != pc;
+				set.quantum = stoul(arg);
+				break;
+			}
 
-			switch (branchPred) {
-				case simulator::branchPredType::NONE:
-					executedCode.push_back(nop);
-					if (!branchInDec) executedCode.push_back(nop);
-					break;
+			case PARSER: {
+				string arg = string(optarg);
+				if (arg == "mmap") {
+					set.mapInput = true;
+				} else if (arg != "bison") {
+					cerr << "Error: Unknown parser " << arg << endl;
+					return -1;
+				}
 
-				case simulator::branchPredType::TAKEN:
-					if (!taken) {
-						executedCode.push_back(nop);
-						if (!branchInDec) executedCode.push_back(nop);
-					}
-					break;
+				break;
+			}
 
-				case simulator::branchPredType::NOT_TAKEN:
-					if (taken) {
-						executedCode.push_back(nop);
-						if (!branchInDec) executedCode.push_back(nop);
-					}
-					break;
+			case 'h':
+				cout
+					<< "MIPS Pipeline Simulator Options\n"
+					   "\t-i --input [file]\t\tSpecify the input file to read from.\n"
+					   "\t-o --output [file]\t\tSpecify the output file to write to.\n"
+					   "\t-n --nops\t\t\tAdds NOPs to the resulting code rather than printing the diagram.\n"
+					   "\t-d --branch-in-dec\t\tBranch jump address is calculated in the decode phase.\n"
+					   "\t-u --unlimited\t\t\tDisables hard limit on amount of executed instructions.\n"
+					   "\t-t --tabs\t\t\tUse tabs instead of spaces for separating pipeline phases.\n"
+					   "\t-s --stats-only\t\t\tOnly print the statistics, without the diagram.\n"
+					   "\t--compress-loops\t\tPrint only once the iterations of a loop that repeat the previous one.\n"
+					   "\t-f --forwarding <no|alu|full>\tChoose between the following forwarding options:\n"
+					   "\t\t* no: No forwarding.\n\t\t* alu: Only ALU-ALU (EX to EX) forwarding.\n"
+					   "\t\t* full: Full forwarding.\n"
+					   "\t-b --branch [no|p|t|nt|1bit|2bit|gshare]\n"
+					   "\t\t\t\t\tChoose between the following branch prediction options:\n"
+					   "\t\t* no: No branch prediction.\n\t\t* p: Perfect branch prediction.\n"
+					   "\t\t* t: Always predict as taken.\n\t\t* nt: Always predict as not taken.\n"
+					   "\t\t* 1bit: Predict the last outcome of each branch.\n"
+					   "\t\t* 2bit: Use a 2-bit saturating counter for each branch.\n"
+					   "\t\t* gshare: Use 2-bit counters indexed by each branch and the outcome of the last ones.\n"
+					   "\t--bp-table <n>\t\t\tUse n counters for the dynamic predictors. By default, 1024.\n"
+					   "\t--bp-history <n>\t\tKeep the outcome of the last n branches for gshare. By default, 8.\n"
+					   "\t--btb <n>\t\t\tPredict targets with a branch target buffer of n entries. By default, none.\n"
+					   "\t--cache <bytes>\t\t\tSimulate a data cache of the given size. By default, there is none.\n"
+					   "\t--cache-line <bytes>\t\tSize of the lines of the data cache, 4 or more. By default, 32.\n"
+					   "\t--cache-ways <n>\t\tLines in every set of the data cache. By default, 1.\n"
+					   "\t--cache-replace <lru|fifo|random>\tChoose which line of a set is replaced. By default, lru.\n"
+					   "\t--cache-write <back|through>\tChoose between the following write policies:\n"
+					   "\t\t* back: Stores only write to the cache and bring the line on a miss (default).\n"
+					   "\t\t* through: Stores always write to memory without stalling and never bring the line.\n"
+					   "\t--cache-penalty <n>\t\tStall n cycles on every miss of the data cache. By default, 10.\n"
+					   "\t--memory <paged|mapped>\tChoose how the data memory is kept:\n"
+					   "\t\t* paged: Allocate its pages the first time they are used, anywhere in memory (default).\n"
+					   "\t\t* mapped: Reserve it at once, without checks. Accesses outside of it are errors.\n"
+					   "\t--memory-size <bytes>\t\tBytes of the mapped memory. By default, the ones of the variables.\n"
+					   "\t--dispatch <switch|threaded|block|check>\tChoose how instructions are executed:\n"
+					   "\t\t* switch: Decode every instruction when it is executed.\n"
+					   "\t\t* threaded: Bind every instruction to its operation beforehand.\n"
+					   "\t\t* block: Execute whole basic blocks, fusing common pairs of instructions.\n"
+					   "\t\t* check: Use block, but first check that threaded and block behave the same as switch.\n"
+					   "\t--sweep\t\t\t\tPrint the statistics of every forwarding and branch option instead.\n"
+					   "\t--batch <dir|list>\t\tSimulate every .asm file in the directory or every file in the list.\n"
+					   "\t\tThe output of each one is written to a .out file in the output directory or next to it.\n"
+					   "\t--parser <bison|mmap>\t\tChoose how input files are parsed:\n"
+					   "\t\t* bison: Read them through the flex scanner and the bison grammar.\n"
+					   "\t\t* mmap: Map them in memory and tokenize them in place, which is faster for big files.\n"
+					   "\t--compile <file>\t\tSave the translated program to a binary file instead of simulating it.\n"
+					   "\t--load <file>\t\t\tSimulate a program saved with --compile instead of the input.\n"
+					   "\t--checkpoint <file>\t\tSave the state of the simulation to the file periodically.\n"
+					   "\t--checkpoint-every <n>\t\tSave the checkpoint every n cycles. By default, every million.\n"
+					   "\t--restore <file>\t\tResume the simulation from a checkpoint of the same program and options.\n"
+					   "\t--trace <file>\t\t\tAlso write every executed instruction and stall to a binary file.\n"
+					   "\t--sample <n>\t\t\tEstimate the statistics simulating only a window every n instructions.\n"
+					   "\t--sample-window <n>\t\tMeasure n instructions in every window. By default, 1000.\n"
+					   "\t--sample-warmup <n>\t\tSimulate n instructions before every window to fill the pipeline. "
+					   "By default, 100.\n"
+					   "\t--skip <n>\t\t\tExecute the first n instructions without timing before simulating.\n"
+					   "\t--skip-to <label>\t\tExecute without timing until the label is reached, then simulate.\n"
+					   "\t--cores <n>\t\t\tSimulate n cores sharing the memory, each with its index in $26.\n"
+					   "\t--quantum <n>\t\t\tExecute n instructions in every core between barriers, up to a million. "
+					   "By default, 10000.\n"
+					   "\t-j --jobs <n>\t\t\tUse n threads for the sweep, the batch or the cores. By default, one per "
+					   "hardware thread.\n"
+					   "\nNote that if no input/output file is specified then the standard input/output will be used.\n"
+					   "If the forwarding option (-f) is used but no additional value is passed then full forwarding "
+					   "will be used."
+					<< endl;
 
-				default:
-					break;
-			}
+				return 0;
 
-			continue;
+			case '?': // getopt_long handles error printing
+				return -1;
 		}
+	}
 
-		if (instr.type == simulator::instrType::J) {
-			executedCode.push_back(nop);
-			continue;
-		}
+	bool checkpoints = !set.checkpointPath.empty() || !set.restorePath.empty();
+	if (checkpoints && (set.sweep || !batchPath.empty() || !set.compilePath.empty())) {
+		cerr << "Error: Checkpoints cannot be used together with --sweep, --batch or --compile." << endl;
+		return -1;
+	}
 
-		char regWrittenIdx = -1;
+	if (!set.tracePath.empty() && (set.sweep || set.samplePeriod > 0 || !batchPath.empty() ||
+								   !set.restorePath.empty() || !set.compilePath.empty())) {
+		cerr << "Error: --trace cannot be used together with --sweep, --sample, --batch, --restore or --compile."
+			 << endl;
+		return -1;
+	}
 
-		switch (instr.getRegWritten()) {
-			case simulator::regType::RS:
-				regWrittenIdx = instr.rS;
-				break;
-			case simulator::regType::RT:
-				regWrittenIdx = instr.rT;
-				break;
-			case simulator::regType::RD:
-				regWrittenIdx = instr.rD;
-				break;
-			default:
-				break;
-		}
+	if (set.cache.size > 0 && (set.sweep || set.samplePeriod > 0)) {
+		cerr << "Error: --cache cannot be used together with --sweep or --sample." << endl;
+		return -1;
+	}
 
-		if (regWrittenIdx < 0) continue;
+	if (set.mapMemory && checkpoints) {
+		cerr << "Error: --memory mapped cannot be used together with checkpoints." << endl;
+		return -1;
+	}
 
-		regLast = regWrittenIdx;
+	if (set.cache.size > 0 && set.cache.size < (uint64_t)set.cache.lineSize * set.cache.ways) {
+		cerr << "Error: The data cache must have room for a line in every way." << endl;
+		return -1;
+	}
 
-		regBusy[regWrittenIdx] = (char)instr.calcResultDone();
-		regDirty[regWrittenIdx] = (char)simulator::pipPhase::WRITEBACK - 2; // minus F & WB
+	if (set.compressLoops && checkpoints) {
+		cerr << "Error: --compress-loops cannot be used together with checkpoints." << endl;
+		return -1;
 	}
 
-	uint pos = 0; // Position of the cursor in the pipeline diagram.
-	uint fetchpos = 0; // Position of the next fetch (first phase) in the pipeline diagram.
-	uint lastpos = 0; // Position of the last phase in the map (used for counting cycles).
-	uint instrCnt = 0; // Amount of actual instructions (removing SNOPs).
-	unordered_set<int> stalls; // Set of stalls already placed in the pipeline diagram.
+	if (set.samplePeriod > 0 && (set.sweep || checkpoints)) {
+		cerr << "Error: --sample cannot be used together with --sweep or checkpoints." << endl;
+		return -1;
+	}
 
-	int lasti = -1; // Stores last instruction that was not an SNOP.
+	if (set.samplePeriod > 0 && set.samplePeriod < set.sampleWindow + set.sampleWarmup) {
+		cerr << "Error: The sampling period must be at least as long as the window and the warm-up together." << endl;
+		return -1;
+	}
 
-	bool lastBranch = false; // Last instruction was a branch.
+	if (set.skipCount > 0 && !set.skipLabel.empty()) {
+		cerr << "Error: --skip cannot be used together with --skip-to." << endl;
+		return -1;
+	}
 
-	auto printPhase = [&pos, &stalls, useTabs](char phase) {
-		while (stalls.contains(pos++)) {
-			cout << (useTabs ? "\t" : "   ");
-		}
+	if ((set.skipCount > 0 || !set.skipLabel.empty()) && !set.restorePath.empty()) {
+		cerr << "Error: --skip and --skip-to cannot be used together with --restore." << endl;
+		return -1;
+	}
+
+	if (set.cores > 1 && (set.sweep || set.samplePeriod > 0 || checkpoints || !set.tracePath.empty() ||
+						  set.cache.size > 0 || set.skipCount > 0 || !set.skipLabel.empty())) {
+		cerr << "Error: --cores cannot be used together with --sweep, --sample, checkpoints, --trace, --cache, --skip "
+				"or --skip-to."
+			 << endl;
+		return -1;
+	}
 
-		cout << phase << (useTabs ? "\t" : "  ");
-	};
+	if (!batchPath.empty() && (!set.compilePath.empty() || !loadPath.empty())) {
+		cerr << "Error: --batch cannot be used together with --compile or --load." << endl;
+		return -1;
+	}
+
+	if (!batchPath.empty()) {
+		vector<string> files;
+
+		if (filesystem::is_directory(batchPath)) {
+			for (const filesystem::directory_entry &entry : filesystem::directory_iterator(batchPath)) {
+				if (entry.is_regular_file() && entry.path().extension() == ".asm")
+					files.push_back(entry.path().string());
+			}
 
-	for (uint i = 0; i < executedCode.size(); i++) {
-		simulator::instruction instr = executedCode[i];
-		string instrStr = instr.toString(instrcol);
-		if (instrStr.empty()) continue;
+			sort(files.begin(), files.end());
+		} else {
+			ifstream list(batchPath);
+			if (!list.is_open()) {
+				cerr << "Error: File " << batchPath << " does not exist or cannot be opened." << endl;
+				return -1;
+			}
 
-		cout << instrStr;
-		if (useRegularNOPs) {
-			cout << endl;
-			continue;
+			for (string file; getline(list, file);) {
+				if (!file.empty()) files.push_back(file);
+			}
 		}
 
-		uint start = diagramStart - instrStr.length() + 4;
-		for (uint i = 0; i <= start; i++) {
-			cout << ' ';
+		if (!oPath.empty() && !filesystem::is_directory(oPath)) {
+			cerr << "Error: Directory " << oPath << " does not exist." << endl;
+			return -1;
 		}
 
-		if (useTabs) cout << '\t';
+		return runner::runBatch(files, oPath, set, cout) ? 0 : -1;
+	}
 
-		// Stalls before decoding phase.
-		bool stallsDec = forwarding != simulator::forwardingType::FULL;
+	if (!loadPath.empty() && (iFile.is_open() || !set.compilePath.empty())) {
+		cerr << "Error: --load cannot be used together with --input or --compile." << endl;
+		return -1;
+	}
 
-		for (int i = 0; i < pos; i++)
-			cout << (useTabs ? "\t" : "   ");
+	// The standard input is always read through flex and bison.
+	parser::mappedFile mapped;
+	if (set.mapInput && iFile.is_open() && !mapped.open(iPath)) {
+		cerr << "Error: File " << iPath << " does not exist or cannot be opened." << endl;
+		return -1;
+	}
 
-		if (!lastBranch) printPhase('F');
+	if (iFile.is_open()) cin.rdbuf(iFile.rdbuf());
 
-		if (!stallsDec && !lastBranch) {
-			printPhase('D');
-			fetchpos = pos - 1;
+	if (!oPath.empty()) {
+		oFile = ofstream(oPath);
+		if (!oFile.is_open()) {
+			cerr << "Error: File " << oPath << " could not be opened for writing." << endl;
+			return -1;
 		}
 
-		if (lasti >= 0)
-			for (int j = lasti + 1; executedCode[j].type == simulator::instrType::SNOP && j < executedCode.size();
-				 j++) {
-
-				cout << (useTabs ? "S\t" : "S  ");
-				stalls.insert(pos++);
-			}
+		cout.rdbuf(oFile.rdbuf());
+	}
 
-		if (lastBranch) printPhase('F');
+	// The output is written by another thread, so that the simulation does not wait for it.
+	parallel::asyncWriter writer(cout);
+	bool ok;
 
-		if (stallsDec || lastBranch) {
-			printPhase('D');
-			fetchpos = pos - 1;
-		}
+	if (!loadPath.empty())
+		ok = runner::runCompiled(loadPath, set, cout, cerr).ok;
+	else if (set.mapInput && iFile.is_open())
+		ok = runner::runSource(mapped.text(), set, cout, cerr).ok;
+	else
+		ok = runner::runFile(cin, set, cout, cerr).ok;
 
-		cout << (useTabs ? "X\tM\tW" : "X  M  W") << endl;
-		lastpos = pos + 3;
-		pos = fetchpos;
-		lasti = i;
-		instrCnt++;
-		lastBranch = instr.type == simulator::instrType::BRA1 || instr.type == simulator::instrType::BRA2 ||
-					 instr.type == simulator::instrType::J;
+	if (!writer.close()) {
+		cerr << "Error: The output could not be written." << endl;
+		return -1;
 	}
 
-	if (!useRegularNOPs) {
-		cout << "\nCycles: " << lastpos << "\nAverage CPI: " << lastpos << '/' << instrCnt << " = "
-			 << (float)lastpos / instrCnt << endl;
-	}
+	return ok ? 0 : -1;
 }
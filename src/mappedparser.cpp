@@ -0,0 +1,384 @@
+#include "mappedparser.h"
+#include <array>
+#include <climits>
+#include <cstring>
+
+#if WINNT
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace parser
+{
+// Every mnemonic that the translator accepts, so that most names need neither a copy nor a map.
+static constexpr const char *mnemonics[] = {
+	"ADD",	"ADDU", "ADDI", "ADDIU", "SUB", "SUBU", "AND", "ANDI", "OR", "ORI", "NOR", "NORI", "XOR", "XORI", "NOP",
+	"NOOP", "LB",	"LH",	"LW",	 "SB",	"SH",	"SW",  "BEQ",  "BNE", "BGEZ", "BGTZ", "BLEZ", "BLTZ", "J",
+	"DEF",	"DEV",	"DEFB", "DEFH",	 "DEFW", "DEVB", "DEVH", "DEVW"};
+
+static constexpr uint maxMnemonicLength = 5;
+static constexpr uint mnemonicTableSize = 64;
+
+// Perfect hash of the mnemonics above, which are all different in their first 4 characters or their length.
+static constexpr uint mnemonicHash(string_view name)
+{
+	auto at = [&name](uint i) -> uint { return i < name.size() ? (unsigned char)name[i] : 0; };
+	return (at(0) * 56 + at(1) * 4 + at(2) * 33 + at(3) * 49 + name.size() * 37) & (mnemonicTableSize - 1);
+}
+
+static constexpr array<const char *, mnemonicTableSize> mnemonicTable = [] {
+	array<const char *, mnemonicTableSize> table = {};
+	for (const char *name : mnemonics)
+		table[mnemonicHash(name)] = name;
+
+	return table;
+}();
+
+static_assert(
+	[] {
+		for (const char *name : mnemonics) {
+			if (mnemonicTable[mnemonicHash(name)] != name || string_view(name).size() > maxMnemonicLength)
+				return false;
+		}
+
+		return true;
+	}(),
+	"The mnemonic hash has collisions.");
+
+static char toUpper(char c)
+{
+	return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+}
+
+static bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool isLetter(char c)
+{
+	return toUpper(c) >= 'A' && toUpper(c) <= 'Z';
+}
+
+// Same result as atoi, including its saturation on overflow before the conversion to int.
+static int toInt(string_view digits, bool negative)
+{
+	unsigned long value = 0;
+	bool overflow = false;
+
+	for (char c : digits) {
+		uint digit = c - '0';
+		if (value > (ULONG_MAX - digit) / 10) overflow = true;
+		value = value * 10 + digit;
+	}
+
+	long res;
+	if (negative) {
+		res = overflow || value > (unsigned long)LONG_MAX + 1 ? LONG_MIN : (long)(0 - value);
+	} else {
+		res = overflow || value > (unsigned long)LONG_MAX ? LONG_MAX : (long)value;
+	}
+
+	return (int)res;
+}
+
+mappedFile::~mappedFile()
+{
+#if WINNT
+	delete[] data;
+#else
+	if (size > 0) munmap((void *)data, size);
+#endif
+}
+
+bool mappedFile::open(const string &path)
+{
+#if WINNT
+	// Without mmap, the file is read whole instead.
+	ifstream in(path, ios::binary | ios::ate);
+	if (!in.is_open()) return false;
+
+	size = in.tellg();
+	char *buffer = new char[size];
+	in.seekg(0);
+	in.read(buffer, size);
+	data = buffer;
+
+	return !in.fail();
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat info;
+	bool opened = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+
+	// Empty files cannot be mapped.
+	if (opened && info.st_size > 0) {
+		void *ptr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		opened = ptr != MAP_FAILED;
+
+		if (opened) {
+			data = (const char *)ptr;
+			size = info.st_size;
+			madvise(ptr, size, MADV_SEQUENTIAL);
+		}
+	}
+
+	close(fd);
+	return opened;
+#endif
+}
+
+// Tokens follow the rules of the flex scanner: the longest match wins, and the first rule on a tie.
+void mappedParser::next()
+{
+	while (pos < end) {
+		const char *start = pos;
+		char c = *pos;
+
+		// Comments always reach the end of the line, so they win over labels.
+		if (c == '/' || c == '@' || c == '#' || c == ';') {
+			const char *eol = (const char *)memchr(pos, '\n', end - pos);
+			pos = eol ? eol : end;
+			continue;
+		}
+
+		// A label goes from the start of the line, spaces included, to its last colon.
+		if ((pos == begin || pos[-1] == '\n') && c != '\n') {
+			const char *eol = (const char *)memchr(pos, '\n', end - pos);
+			const char *colon = eol ? eol - 1 : end - 1;
+
+			while (colon > pos && *colon != ':')
+				colon--;
+
+			if (colon > pos) {
+				text = string_view(pos, colon - pos);
+				pos = colon + 1;
+				tok = token::LABEL;
+				return;
+			}
+		}
+
+		switch (c) {
+			case ' ':
+			case '\t':
+			case '\r':
+				while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+					pos++;
+
+				continue;
+
+			case '\n':
+				while (pos < end && *pos == '\n')
+					pos++;
+
+				tok = token::NEXT;
+				return;
+
+			case '(':
+				pos++;
+				tok = token::LPAREN;
+				return;
+
+			case ')':
+				pos++;
+				tok = token::RPAREN;
+				return;
+
+			case ',':
+				pos++;
+				tok = token::SEPARATOR;
+				return;
+
+			default:
+				break;
+		}
+
+		// Registers have 1 or 2 digits, any other digit starts an immediate.
+		if ((c == '$' || toUpper(c) == 'R') && pos + 1 < end && isDigit(pos[1])) {
+			pos += pos + 2 < end && isDigit(pos[2]) ? 3 : 2;
+			number = toInt(string_view(start + 1, pos), false);
+			tok = token::R;
+			return;
+		}
+
+		if (isDigit(c) || (c == '-' && pos + 1 < end && isDigit(pos[1]))) {
+			pos++;
+			while (pos < end && isDigit(*pos))
+				pos++;
+
+			number = c == '-' ? toInt(string_view(start + 1, pos), true) : toInt(string_view(start, pos), false);
+			tok = token::IM;
+			return;
+		}
+
+		if (isLetter(c)) {
+			while (pos < end && isLetter(*pos))
+				pos++;
+
+			text = string_view(start, pos);
+			tok = token::ID;
+			return;
+		}
+
+		// Flex prints the text as a C string, so a null character prints nothing.
+		*err << "Error. Incorrect data found: " << endl;
+		if (c != 0) *err << c;
+		*err << endl;
+		pos++;
+	}
+
+	tok = token::END;
+}
+
+void mappedParser::syntaxError()
+{
+	*err << "syntax error" << endl;
+}
+
+const char *mappedParser::copyUpper(string_view str)
+{
+	char *copy = (char *)mem.alloc(str.size() + 1, 1);
+
+	for (uint i = 0; i < str.size(); i++)
+		copy[i] = toUpper(str[i]);
+
+	copy[str.size()] = 0;
+	return copy;
+}
+
+const char *mappedParser::intern(string_view name)
+{
+	if (name.size() <= maxMnemonicLength) {
+		char upper[maxMnemonicLength];
+		for (uint i = 0; i < name.size(); i++)
+			upper[i] = toUpper(name[i]);
+
+		string_view key(upper, name.size());
+		const char *mnemonic = mnemonicTable[mnemonicHash(key)];
+		if (mnemonic != nullptr && key == mnemonic) return mnemonic;
+	}
+
+	return copyUpper(name);
+}
+
+bool mappedParser::parseOperand(operand &outRes)
+{
+	if (tok == token::ID) {
+		outRes = {.type = optype::OPLABEL, .label = copyUpper(text)};
+		next();
+		return true;
+	}
+
+	int im = number;
+	next();
+
+	if (tok != token::LPAREN) {
+		outRes = {.type = optype::OPIM, .im = im};
+		return true;
+	}
+
+	next();
+	if (tok != token::R) {
+		syntaxError();
+		return false;
+	}
+
+	int reg = number;
+	next();
+	if (tok != token::RPAREN) {
+		syntaxError();
+		return false;
+	}
+
+	outRes = {.type = optype::OPINDIRECT, .indir = {.im = im, .reg = reg}};
+	next();
+	return true;
+}
+
+bool mappedParser::parseOperands(instruction &outRes)
+{
+	if (tok == token::IM || tok == token::ID) return parseOperand(outRes.op);
+	if (tok != token::R) return true; // No operands.
+
+	outRes.rlist[0] = number;
+	outRes.rcount = 1;
+	next();
+
+	while (tok == token::SEPARATOR) {
+		next();
+
+		// Any other operand must be the last one.
+		if (tok == token::IM || tok == token::ID) return parseOperand(outRes.op);
+
+		if (tok != token::R) {
+			syntaxError();
+			return false;
+		}
+
+		if (outRes.rcount > 2) {
+			*err << "Error: Too many registers." << endl;
+		} else {
+			outRes.rlist[outRes.rcount++] = number;
+		}
+
+		next();
+	}
+
+	return true;
+}
+
+// Bison reduces as soon as a rule is complete without checking the lookahead, so a line is added to the code
+// before a wrong token after it is found.
+vector<instruction> mappedParser::parse(string_view source, ostream &err)
+{
+	vector<instruction> code;
+
+	mem.clear();
+	begin = pos = source.data();
+	end = begin + source.size();
+	this->err = &err;
+
+	next();
+
+	while (true) {
+		instruction instr = {};
+
+		if (tok == token::LABEL) {
+			instr.label = copyUpper(text);
+			next();
+
+			if (tok == token::NEXT) next(); // The label can be alone in its line.
+
+			if (tok != token::ID) {
+				syntaxError();
+				break;
+			}
+		}
+
+		// Empty lines are not added to the code.
+		if (tok == token::ID) {
+			instr.name = intern(text);
+			next();
+
+			if (!parseOperands(instr)) break;
+			code.push_back(instr);
+		}
+
+		if (tok == token::END) break;
+
+		if (tok != token::NEXT) {
+			syntaxError();
+			break;
+		}
+
+		next();
+	}
+
+	return code;
+}
+} // namespace parser
@@ -0,0 +1,118 @@
+#include "multicore.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <memory>
+
+namespace simulator
+{
+// Everything a core does not share with the others.
+class core
+{
+  public:
+	int regs[32];
+	uint pc = 0;
+	interpreter interp;
+
+	vector<int> trace; // Instructions executed but not fetched yet.
+	pipeline pipe;
+
+	coreResult result;
+	bool done = false;
+
+	core(program &prog, uint id, const coreConfig &config)
+		: interp(prog.code, prog.dataMem, regs, config.dispatch),
+		  pipe(prog.code, trace, 0, config.forwarding, config.branchPred, config.branchInDec, config.predictor)
+	{
+		copy(prog.regs, prog.regs + 32, regs);
+		regs[(int)coreIdReg] = id;
+	}
+};
+
+// Instructions the trace of a core grows by at once, so that it only takes as much memory as the quantum needs.
+static const uint traceChunk = 1 << 16;
+
+// Executes the next quantum of the core and adds it to what its pipeline has not fetched yet.
+static void execute(core &c, uint quantum, uint codeCnt)
+{
+	if (c.pc >= codeCnt) return;
+
+	c.trace.erase(c.trace.begin(), c.trace.end() - c.pipe.pending());
+
+	for (uint left = quantum; left > 0 && c.pc < codeCnt;) {
+		uint chunk = min(left, traceChunk);
+		size_t end = c.trace.size();
+
+		c.trace.resize(end + chunk);
+		uint executed = c.interp.run(c.pc, chunk, c.trace.data() + end);
+		c.trace.resize(end + executed);
+
+		if (executed < chunk) break;
+		left -= chunk;
+	}
+
+	if (const memoryFault *fault = c.interp.getFault()) {
+		c.result.faulted = true;
+		c.result.fault = *fault;
+	}
+
+	c.pipe.extend(c.trace, c.pc);
+}
+
+// Simulates cycles until the pipeline of the core needs the next quantum or it finishes.
+static void simulate(core &c, uint limit)
+{
+	while (!c.pipe.needsTrace()) {
+		if (!c.pipe.step()) {
+			c.done = true;
+			return;
+		}
+
+		const timing *executing = c.pipe.executing();
+		if (executing == nullptr) continue;
+
+		// Same limit as when simulating a single core.
+		if (executing->execute - 2 > limit) {
+			c.result.limitReached = true;
+			c.done = true;
+			return;
+		}
+
+		c.result.instrCnt++;
+		c.result.cycles = executing->execute + 3;
+	}
+}
+
+bool simulateCores(program &prog, const coreConfig &config, uint limit, uint threads, vector<coreResult> &results)
+{
+	vector<unique_ptr<core>> cores;
+	for (uint id = 0; id < config.cores; id++)
+		cores.push_back(make_unique<core>(prog, id, config));
+
+	parallel::threadPool pool(threads);
+	bool faulted = false;
+
+	uint codeCnt = prog.code.size();
+
+	while (!faulted && any_of(cores.begin(), cores.end(), [](const unique_ptr<core> &c) { return !c->done; })) {
+		// Barrier: the memory is only accessed here, by one core after another.
+		for (unique_ptr<core> &c : cores) {
+			if (c->done) continue;
+
+			execute(*c, config.quantum, codeCnt);
+			faulted |= c->result.faulted;
+		}
+
+		for (unique_ptr<core> &c : cores) {
+			if (!c->done) pool.submit([&c, limit] { simulate(*c, limit); });
+		}
+
+		pool.wait();
+	}
+
+	results.clear();
+	for (unique_ptr<core> &c : cores)
+		results.push_back(c->result);
+
+	return !faulted;
+}
+} // namespace simulator
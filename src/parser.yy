@@ -8,8 +8,8 @@ using namespace parser;
 %{
 
 #include <stdlib.h>
+#include <string.h>
 #include <string>
-#include <unordered_map>
 
 #include "FlexLexer.h"
 #include "parser.hpp"
@@ -22,18 +22,27 @@ int yylex() {
 
 extern void yyerror(const char * msg);
 
-// Maps to prevent duplicated strings.
-unordered_map<string, char *> labelMap;
-unordered_map<string, char *> nameMap;
+// Strings of the instructions, freed all at once.
+arena strings;
 
 // Vector of all parsed instructions.
 vector<instruction> code;
 
-// Array used to manage incoming registers.
-int *rlist = nullptr;
+// Stream where syntax errors are printed.
+std::ostream *errOut = &cerr;
 
-vector<instruction> parser::parse(std::istream *in) {
+// Copies the text of a token to the arena, ended by a null character.
+char *copyToken(const char *text, size_t length) {
+	char *str = (char *)strings.alloc(length + 1, 1);
+	memcpy(str, text, length);
+	str[length] = 0;
+
+	return str;
+}
+
+vector<instruction> parser::parse(std::istream *in, std::ostream *err) {
 	scanner = new yyFlexLexer(in);
+	errOut = err;
 	yyparse();
 	
 	return code;
@@ -42,37 +51,8 @@ vector<instruction> parser::parse(std::istream *in) {
 void parser::freeResources() {
 	delete scanner;
 
-	for (auto& pair : labelMap) {
-		free(pair.second);
-	}
-
-	for (auto& pair : nameMap) {
-		free(pair.second);
-	}
-
-	for (instruction instr : code) {
-		if (instr.op.ptr) {
-			switch (instr.op.type) {
-				case optype::OPIM:
-					delete (int *)instr.op.ptr;
-					break;
-
-				case optype::OPINDIRECT:
-					delete (indirect *)instr.op.ptr;
-					break;
-
-				default:
-					break;
-
-				// Note: Labels were already freed.
-			}
-		}
-	}
-
-	labelMap.clear();
-	nameMap.clear();
+	strings.clear();
 	code.clear();
-	rlist = nullptr;
 }
 
 %}
@@ -113,30 +93,12 @@ E:		  E NEXT L				{
 
 L:		  LABEL I				{
 			instruction i = $<instr>2;
-			string label = string($<string>1);
-
-			if (labelMap.contains(label)) {
-				i.label = labelMap[label];
-				free($<string>1);
-			} else {
-				labelMap[label] = $<string>1;
-				i.label = $<string>1;
-			}
-
+			i.label = $<string>1;
 			$<instr>$ = i;
 		}
 		| LABEL NEXT I			{ // Allows declaring only label in line
 			instruction i = $<instr>3;
-			string label = string($<string>1);
-
-			if (labelMap.contains(label)) {
-				i.label = labelMap[label];
-				free($<string>1);
-			} else {
-				labelMap[label] = $<string>1;
-				i.label = $<string>1;
-			}
-
+			i.label = $<string>1;
 			$<instr>$ = i;
 		}
 		| I						{ $<instr>$ = $<instr>1; }
@@ -145,22 +107,15 @@ L:		  LABEL I				{
 
 I:		  ID C					{
 			instruction i = $<instr>2;
-			string name = string($<string>1);
-
-			if (nameMap.contains(name)) {
-				i.name = nameMap[name];
-				free($<string>1);
-			} else {
-				nameMap[name] = $<string>1;
-				i.name = $<string>1;
-			}
-
+			i.name = $<string>1;
 			$<instr>$ = i;
 		}
 		;
 
 C:		  RLIST AUX				{
-			$<instr>$ = { .rlist = rlist, .rcount = $<number>1, .op = $<op>2 };
+			instruction i = $<instr>1;
+			i.op = $<op>2;
+			$<instr>$ = i;
 		}
 		| O						{ $<instr>$ = { .op = $<op>1 }; }
 		|						{ $<instr>$ = { }; }
@@ -170,44 +125,29 @@ AUX:	  SEPARATOR O			{ $<op>$ = $<op>2; }
 		|						{ $<op>$ = { }; }
 		;
 
-O:		  ID					{
-			char *ptr = $<string>1;
-			string label = string($<string>1);
-
-			if (labelMap.contains(label)) {
-				free(ptr);
-				ptr = labelMap[label];
-			}
-
-			$<op>$ = { .type = optype::OPLABEL, .ptr = ptr };
-		}
+O:		  ID					{ $<op>$ = { .type = optype::OPLABEL, .label = $<string>1 }; }
 		| IM LPAREN R RPAREN	{
-			indirect *ptr = new indirect{ .im = $<number>1, .reg = $<number>3 };
-			$<op>$ = { .type = optype::OPINDIRECT, .ptr = ptr };
-		}
-		| IM					{
-			$<op>$ = { .type = optype::OPIM, .ptr = new int{$<number>1} };
+			$<op>$ = { .type = optype::OPINDIRECT, .indir = { .im = $<number>1, .reg = $<number>3 } };
 		}
+		| IM					{ $<op>$ = { .type = optype::OPIM, .im = $<number>1 }; }
 		;
 
 RLIST:	  RLIST SEPARATOR R		{
-			if ($<number>1 > 2) {
+			instruction i = $<instr>1;
+
+			if (i.rcount > 2) {
 				yyerror("Error: Too many registers.");
-				$<number>$ = $<number>1;
 			} else {
-				rlist[$<number>1] = $<number>3;
-				$<number>$ = $<number>1 + 1;
+				i.rlist[i.rcount++] = $<number>3;
 			}
+
+			$<instr>$ = i;
 		}
-		| R						{
-			rlist = new int[3];
-			rlist[0] = $<number>1;
-			$<number>$ = 1;
-		}
+		| R						{ $<instr>$ = { .rlist = { $<number>1 }, .rcount = 1 }; }
 		;
 
 %%
 
 void yyerror(const char *error) {
-  cerr << error << endl;
+  *errOut << error << endl;
 }
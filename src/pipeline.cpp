@@ -0,0 +1,394 @@
+#include "pipeline.h"
+#include <algorithm>
+#include <climits>
+
+namespace simulator
+{
+// Mask with the bit of the register, which is empty for $0 since it is never written.
+static uint regBit(reg r)
+{
+	return r > 0 ? 1u << r : 0;
+}
+
+static vector<hazardInfo> calcHazards(span<const decodedInstr> code)
+{
+	vector<hazardInfo> hazards(code.size());
+
+	for (uint i = 0; i < code.size(); i++) {
+		const decodedInstr &instr = code[i];
+		hazardInfo &info = hazards[i];
+
+		info.rS = instr.rS;
+		info.rT = instr.rT;
+		info.rSNeeded = instr.calcRSNeeded();
+		info.rTNeeded = instr.calcRTNeeded();
+		info.resultDone = instr.calcResultDone();
+
+		if (info.rSNeeded != pipPhase::NONE) info.sources |= regBit(instr.rS);
+		if (info.rTNeeded != pipPhase::NONE) info.sources |= regBit(instr.rT);
+
+		switch (instr.getRegWritten()) {
+			case regType::RS:
+				info.written = instr.rS;
+				break;
+			case regType::RT:
+				info.written = instr.rT;
+				break;
+			case regType::RD:
+				info.written = instr.rD;
+				break;
+			default:
+				break;
+		}
+	}
+
+	return hazards;
+}
+
+pipeline::pipeline(span<const decodedInstr> code, interpreter &interp, forwardingType forwarding,
+				   branchPredType branchPred, bool branchInDec, const predictorConfig &predictor,
+				   const cacheConfig &cache, uint startPc, bool addresses)
+	: code(code), interp(&interp), forwarding(forwarding), branchPred(branchPred), branchInDec(branchInDec),
+	  predictor(branchPred, predictor), cache(cache), withAddresses(this->cache.enabled() || addresses),
+	  hazards(calcHazards(code)), pc(startPc)
+{
+}
+
+pipeline::pipeline(span<const decodedInstr> code, const vector<int> &trace, uint endPc, forwardingType forwarding,
+				   branchPredType branchPred, bool branchInDec, const predictorConfig &predictor)
+	: code(code), interp(nullptr), forwarding(forwarding), branchPred(branchPred), branchInDec(branchInDec),
+	  predictor(branchPred, predictor), cache({}), withAddresses(false), hazards(calcHazards(code)), pc(endPc),
+	  ahead(trace.data()), aheadCnt(trace.size())
+{
+}
+
+void pipeline::replay(const vector<int> &trace, uint endPc)
+{
+	ifLatch = idLatch = exLatch = memLatch = wbLatch = timing();
+	inFlight = 0;
+
+	pc = endPc;
+	fetchFrom = 0;
+	controlEnd = 0;
+	controlIdx = -1;
+	cycle = 0;
+	issued = false;
+
+	ahead = trace.data();
+	aheadCnt = trace.size();
+	aheadPos = 0;
+}
+
+void pipeline::extend(const vector<int> &trace, uint endPc)
+{
+	pc = endPc;
+	ahead = trace.data();
+	aheadCnt = trace.size();
+	aheadPos = 0;
+}
+
+bool pipeline::isReady(reg r, pipPhase needed)
+{
+	uint bit = regBit(r);
+	if (needed == pipPhase::NONE || !(inFlight & bit)) return true;
+
+	// Once the producer gets to the write-back phase, the value can be read in the decode phase during the
+	// same cycle.
+	int dist = cycle - execCycle[r];
+	if (dist > 2) {
+		inFlight &= ~bit;
+		return true;
+	}
+
+	switch (forwarding) {
+		case forwardingType::FULL:
+			// The result can be forwarded to any phase once it has been calculated.
+			return (char)needed + dist > (char)resultDone[r];
+
+		case forwardingType::ALU:
+			// Only from the end of the execution phase to the start of the next one.
+			return dist == 1 && resultDone[r] == pipPhase::EXECUTE;
+
+		default:
+			return false;
+	}
+}
+
+bool pipeline::canExecute()
+{
+	hazardInfo &info = hazards[idLatch.idx];
+
+	// Most instructions don't read any register that is still being calculated.
+	if (!(info.sources & inFlight)) return true;
+
+	return isReady(info.rS, info.rSNeeded) && isReady(info.rT, info.rTNeeded);
+}
+
+bool pipeline::hasLine()
+{
+	const decodedInstr &instr = code[idLatch.idx];
+	if (instr.type != instrType::MEM) return true;
+
+	if (!idAccessed) {
+		idAccessed = true;
+		lineReady = cycle + cache.access(idAddress, instr.op == operation::S);
+	}
+
+	return cycle >= lineReady;
+}
+
+bool pipeline::hasNext()
+{
+	if (aheadPos < aheadCnt) return true;
+	if (interp == nullptr || pc >= code.size()) return false;
+
+	aheadCnt = withAddresses ? interp->runWithAddresses(pc, aheadSize, aheadBuf, aheadAddr)
+							   : interp->run(pc, aheadSize, aheadBuf);
+	aheadPos = 0;
+	return aheadCnt > 0;
+}
+
+void pipeline::fetch()
+{
+	int idx = ahead[aheadPos];
+	const decodedInstr &instr = code[idx];
+
+	if (withAddresses) ifAddress = aheadAddr[aheadPos];
+	aheadPos++;
+
+	ifLatch = {.idx = idx, .fetch = cycle, .penalty = 0, .taken = false};
+
+	if (instr.type == instrType::J) {
+		stats.jumps++;
+
+		// It is not known to be a jump until it is decoded, unless the branch target buffer has it.
+		ifLatch.penalty = 1;
+		ifLatch.taken = true;
+
+		if (isDynamic(branchPred) && predictor.hasBtb()) {
+			stats.btbLookups++;
+
+			if (predictor.findTarget(idx) == (int)instr.target) {
+				stats.btbHits++;
+				ifLatch.penalty = 0;
+			} else {
+				predictor.addTarget(idx, instr.target);
+			}
+		}
+	} else if (instr.type == instrType::BRA1 || instr.type == instrType::BRA2) {
+		uint next = hasNext() ? ahead[aheadPos] : pc;
+		ifLatch.taken = next != (uint)idx + 1;
+		bool mispredicted = false;
+
+		switch (branchPred) {
+			case branchPredType::NONE:
+				mispredicted = true;
+				break;
+
+			case branchPredType::TAKEN:
+				mispredicted = !ifLatch.taken;
+				break;
+
+			case branchPredType::NOT_TAKEN:
+				mispredicted = ifLatch.taken;
+				break;
+
+			case branchPredType::ONE_BIT:
+			case branchPredType::TWO_BIT:
+			case branchPredType::GSHARE: {
+				bool predicted = predictor.predict(idx);
+				predictor.update(idx, ifLatch.taken);
+
+				// Without the target, a branch predicted as taken can only continue with the next instruction.
+				if (predictor.hasBtb()) {
+					if (predicted) {
+						stats.btbLookups++;
+
+						if (predictor.findTarget(idx) == (int)instr.target) stats.btbHits++;
+						else predicted = false;
+					}
+
+					if (ifLatch.taken) predictor.addTarget(idx, instr.target);
+				}
+
+				mispredicted = predicted != ifLatch.taken;
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		stats.branches++;
+		if (mispredicted) {
+			stats.mispredicted++;
+			ifLatch.penalty = branchInDec ? 1 : 2;
+		}
+	}
+
+	// Nothing else is fetched until the branch or jump is resolved.
+	if (ifLatch.penalty > 0) {
+		stats.penaltyCycles += ifLatch.penalty;
+		fetchFrom = UINT_MAX;
+	}
+}
+
+bool pipeline::step()
+{
+	bool execute = idLatch.idx >= 0 && canExecute();
+	bool waitsLine = execute && cache.enabled() && !hasLine();
+	if (waitsLine) execute = false;
+
+	// The memory and write-back phases never stall.
+	wbLatch = memLatch;
+	memLatch = exLatch;
+	exLatch = timing();
+	issued = false;
+
+	if (execute) {
+		exLatch = idLatch;
+		exLatch.execute = cycle;
+		exAddress = idAddress;
+		idLatch = timing();
+		issued = true;
+
+		hazardInfo &info = hazards[exLatch.idx];
+		if (info.written > 0) {
+			execCycle[info.written] = cycle;
+			resultDone[info.written] = info.resultDone;
+			inFlight |= regBit(info.written);
+		}
+
+		// Branches and jumps are resolved either at the end of the decode phase (1 cycle of penalty),
+		// so the next instruction can already be fetched now, or at the end of the execution phase (2 cycles).
+		if (exLatch.penalty > 0) {
+			fetchFrom = cycle + exLatch.penalty - 1;
+			controlEnd = cycle + exLatch.penalty;
+			controlIdx = exLatch.idx;
+		}
+	} else if (waitsLine) {
+		stall = stallType::MEMORY;
+	} else if (idLatch.idx >= 0) {
+		stall = stallType::DATA;
+	} else {
+		stall = cycle <= controlEnd && controlIdx >= 0 ? stallType::CONTROL : stallType::EMPTY;
+	}
+
+	if (idLatch.idx < 0 && ifLatch.idx >= 0) {
+		idLatch = ifLatch;
+		idLatch.decode = cycle;
+		ifLatch = timing();
+
+		idAddress = ifAddress;
+		idAccessed = false;
+	}
+
+	if (ifLatch.idx < 0 && cycle >= fetchFrom && hasNext()) fetch();
+
+	cycle++;
+
+	return hasNext() || ifLatch.idx >= 0 || idLatch.idx >= 0 || exLatch.idx >= 0 || memLatch.idx >= 0 ||
+		   wbLatch.idx >= 0;
+}
+
+const timing *pipeline::executing()
+{
+	return issued ? &exLatch : nullptr;
+}
+
+uint pipeline::executingAddress() const
+{
+	return exAddress;
+}
+
+stallType pipeline::stalled(int &idx) const
+{
+	idx = stall == stallType::DATA || stall == stallType::MEMORY ? idLatch.idx
+		  : stall == stallType::CONTROL							? controlIdx
+																: -1;
+	return issued ? stallType::NONE : stall;
+}
+
+const predictorStats &pipeline::predictions() const
+{
+	return stats;
+}
+
+const cacheStats &pipeline::cacheAccesses() const
+{
+	return cache.getStats();
+}
+
+pipelineState pipeline::getState() const
+{
+	pipelineState state = {.ifLatch = ifLatch,
+						   .idLatch = idLatch,
+						   .exLatch = exLatch,
+						   .memLatch = memLatch,
+						   .wbLatch = wbLatch,
+						   .inFlight = inFlight,
+						   .pc = pc,
+						   .fetchFrom = fetchFrom,
+						   .controlEnd = controlEnd,
+						   .controlIdx = controlIdx,
+						   .cycle = cycle,
+						   .issued = issued,
+						   .stall = stall,
+						   .predictions = stats,
+						   .ifAddress = ifAddress,
+						   .idAddress = idAddress,
+						   .idAccessed = idAccessed,
+						   .lineReady = lineReady,
+						   .pendingCnt = aheadCnt - aheadPos};
+
+	copy(execCycle, execCycle + 32, state.execCycle);
+	copy(resultDone, resultDone + 32, state.resultDone);
+	copy(ahead + aheadPos, ahead + aheadCnt, state.pending);
+	if (withAddresses) copy(aheadAddr + aheadPos, aheadAddr + aheadCnt, state.pendingAddr);
+	return state;
+}
+
+void pipeline::setState(const pipelineState &state)
+{
+	ifLatch = state.ifLatch;
+	idLatch = state.idLatch;
+	exLatch = state.exLatch;
+	memLatch = state.memLatch;
+	wbLatch = state.wbLatch;
+
+	copy(state.execCycle, state.execCycle + 32, execCycle);
+	copy(state.resultDone, state.resultDone + 32, resultDone);
+	inFlight = state.inFlight;
+
+	pc = state.pc;
+	fetchFrom = state.fetchFrom;
+	controlEnd = state.controlEnd;
+	controlIdx = state.controlIdx;
+	cycle = state.cycle;
+	issued = state.issued;
+	stall = state.stall;
+	stats = state.predictions;
+
+	ifAddress = state.ifAddress;
+	idAddress = state.idAddress;
+	idAccessed = state.idAccessed;
+	lineReady = state.lineReady;
+
+	copy(state.pending, state.pending + state.pendingCnt, aheadBuf);
+	copy(state.pendingAddr, state.pendingAddr + state.pendingCnt, aheadAddr);
+	ahead = aheadBuf;
+	aheadCnt = state.pendingCnt;
+	aheadPos = 0;
+}
+
+void pipeline::saveTables(ostream &out) const
+{
+	predictor.save(out);
+	cache.save(out);
+}
+
+bool pipeline::loadTables(string_view &data)
+{
+	return predictor.load(data) && cache.load(data);
+}
+} // namespace simulator
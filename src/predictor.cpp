@@ -0,0 +1,48 @@
+#include "predictor.h"
+#include <algorithm>
+#include <cstring>
+
+namespace simulator
+{
+branchPredictor::branchPredictor(branchPredType type, const predictorConfig &config)
+	: type(type), tableMask(config.tableSize - 1), counterMax(type == branchPredType::ONE_BIT ? 1 : 3),
+	  historyMask((1u << config.historyBits) - 1), btbMask(config.btbSize - 1)
+{
+	if (!isDynamic(type)) return;
+
+	// Every branch starts as not taken, weakly for the 2-bit counters so that a single taken outcome changes it.
+	counters.assign(config.tableSize, counterMax / 2);
+
+	btbTags.assign(config.btbSize, -1);
+	btbTargets.assign(config.btbSize, 0);
+}
+
+void branchPredictor::save(ostream &out) const
+{
+	out.write((const char *)&history, sizeof(history));
+	out.write((const char *)counters.data(), counters.size());
+	out.write((const char *)btbTags.data(), btbTags.size() * sizeof(int));
+	out.write((const char *)btbTargets.data(), btbTargets.size() * sizeof(int));
+}
+
+bool branchPredictor::load(string_view &data)
+{
+	size_t btbBytes = btbTags.size() * sizeof(int);
+	if (data.size() < sizeof(history) + counters.size() + 2 * btbBytes) return false;
+
+	const char *next = data.data();
+	memcpy(&history, next, sizeof(history));
+	history &= historyMask;
+	next += sizeof(history);
+
+	memcpy(counters.data(), next, counters.size());
+	next += counters.size();
+
+	memcpy(btbTags.data(), next, btbBytes);
+	memcpy(btbTargets.data(), next + btbBytes, btbBytes);
+	next += 2 * btbBytes;
+
+	data.remove_prefix(next - data.data());
+	return all_of(counters.begin(), counters.end(), [this](uint8_t counter) { return counter <= counterMax; });
+}
+} // namespace simulator
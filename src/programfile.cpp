@@ -0,0 +1,206 @@
+#include "programfile.h"
+#include "mappedparser.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace translator
+{
+using simulator::pipPhase;
+using simulator::regType;
+
+// The layout of decodedInstr depends on the compiler, so files are only valid for the build that wrote them,
+// which is checked through its size. The version must change with any change of the format.
+static constexpr char magic[8] = "MIPSBIN";
+static constexpr uint32_t version = 1;
+
+// Every section starts at an offset aligned to 8 bytes, so that it can be used in place once mapped.
+class fileHeader
+{
+  public:
+	char magic[8];
+	uint32_t version;
+	uint32_t instrSize;
+	uint32_t codeCnt;
+	uint32_t memSize;
+	uint32_t stringsSize;
+	uint32_t codeOffset; // Compact instructions.
+	uint32_t textOffset; // Strings of every instruction, as textRecord.
+	uint32_t stringsOffset; // Strings ended by a null character, referred by offset.
+	uint32_t memOffset; // Initial contents of the data memory.
+	uint32_t reserved;
+	int32_t regs[32]; // Initial registers, with the addresses of the variables.
+};
+
+class textRecord
+{
+  public:
+	uint32_t label;
+	uint32_t displayName;
+	uint32_t labelOp;
+};
+
+static_assert(alignof(simulator::decodedInstr) <= 8 && alignof(textRecord) <= 8);
+
+static uint32_t align(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+bool saveProgram(const simulator::program &prog, const string &path, ostream &err)
+{
+	fileHeader header = {};
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.instrSize = sizeof(simulator::decodedInstr);
+	header.codeCnt = prog.code.size();
+	header.memSize = prog.dataMem.size();
+	memcpy(header.regs, prog.regs, sizeof(header.regs));
+
+	vector<textRecord> text(prog.codeText.size());
+	string strings;
+
+	auto addString = [&strings](const string &str) -> uint32_t {
+		uint32_t offset = strings.size();
+		strings.append(str.c_str(), str.size() + 1);
+		return offset;
+	};
+
+	for (uint i = 0; i < prog.codeText.size(); i++) {
+		const simulator::instruction &instr = prog.codeText[i];
+		text[i] = {addString(instr.label), addString(instr.displayName), addString(instr.labelOp)};
+	}
+
+	header.stringsSize = strings.size();
+	header.codeOffset = align(sizeof(header));
+	header.textOffset = align(header.codeOffset + (uint64_t)header.codeCnt * header.instrSize);
+	header.stringsOffset = align(header.textOffset + (uint64_t)header.codeCnt * sizeof(textRecord));
+	header.memOffset = align(header.stringsOffset + (uint64_t)header.stringsSize);
+
+	ofstream out(path, ios::binary);
+	if (!out.is_open()) {
+		err << "Error: File " << path << " could not be opened for writing." << endl;
+		return false;
+	}
+
+	auto write = [&out](uint32_t offset, const void *data, size_t size) {
+		static const char padding[8] = {};
+		out.write(padding, offset - out.tellp());
+		out.write((const char *)data, size);
+	};
+
+	out.write((const char *)&header, sizeof(header));
+	write(header.codeOffset, prog.code.data(), prog.code.size() * sizeof(simulator::decodedInstr));
+	write(header.textOffset, text.data(), text.size() * sizeof(textRecord));
+	write(header.stringsOffset, strings.data(), strings.size());
+	vector<char> mem(header.memSize);
+	prog.dataMem.read(0, mem.data(), mem.size());
+	write(header.memOffset, mem.data(), mem.size());
+
+	if (!out.good()) {
+		err << "Error: File " << path << " could not be written." << endl;
+		return false;
+	}
+
+	return true;
+}
+
+// The file is not trusted, so everything that would make the simulator read out of bounds is checked.
+static bool isValid(const fileHeader &header, string_view file)
+{
+	if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+		header.instrSize != sizeof(simulator::decodedInstr))
+		return false;
+
+	auto fits = [&file](uint64_t offset, uint64_t size) -> bool {
+		return offset % 8 == 0 && offset + size <= file.size();
+	};
+
+	if (!fits(header.codeOffset, (uint64_t)header.codeCnt * header.instrSize) ||
+		!fits(header.textOffset, (uint64_t)header.codeCnt * sizeof(textRecord)) ||
+		!fits(header.stringsOffset, header.stringsSize) || !fits(header.memOffset, header.memSize))
+		return false;
+
+	// So that every string offset ends with a null character.
+	if (header.stringsSize > 0 && file[header.stringsOffset + header.stringsSize - 1] != 0) return false;
+
+	for (uint32_t i = 0; i < header.codeCnt; i++) {
+		simulator::decodedInstr instr;
+		memcpy(&instr, file.data() + header.codeOffset + i * sizeof(instr), sizeof(instr));
+
+		textRecord text;
+		memcpy(&text, file.data() + header.textOffset + i * sizeof(text), sizeof(text));
+
+		if ((char)instr.type < 0 || instr.type > simulator::instrType::J || (char)instr.op < 0 ||
+			instr.op > simulator::operation::LTZ || (char)instr.flags.mod < 0 ||
+			instr.flags.mod > simulator::opMod::IMMEDIATE_UNSIGNED)
+			return false;
+
+		// The flags of loads and stores are a size instead, which has fewer values.
+		if (instr.type == simulator::instrType::MEM && instr.flags.size > simulator::dataSize::HALF) return false;
+
+		// Registers that are used must exist, the rest are -1.
+		regType written = instr.getRegWritten();
+		auto isValidReg = [](simulator::reg r, bool used) -> bool { return r >= (used ? 0 : -1) && r <= 31; };
+
+		if (!isValidReg(instr.rS, instr.calcRSNeeded() != pipPhase::NONE || written == regType::RS) ||
+			!isValidReg(instr.rT, instr.calcRTNeeded() != pipPhase::NONE || written == regType::RT) ||
+			!isValidReg(instr.rD, written == regType::RD))
+			return false;
+
+		bool jumps = instr.type == simulator::instrType::BRA1 || instr.type == simulator::instrType::BRA2 ||
+					 instr.type == simulator::instrType::J;
+		if (instr.target < (jumps ? 0 : -1) || instr.target >= (int)header.codeCnt) return false;
+
+		if (text.label >= header.stringsSize || text.displayName >= header.stringsSize ||
+			text.labelOp >= header.stringsSize)
+			return false;
+	}
+
+	return true;
+}
+
+bool loadCompiled(const string &path, simulator::program &outRes, ostream &err)
+{
+	auto mapped = make_shared<parser::mappedFile>();
+	if (!mapped->open(path)) {
+		err << "Error: File " << path << " does not exist or cannot be opened." << endl;
+		return false;
+	}
+
+	string_view file = mapped->text();
+	fileHeader header;
+
+	if (file.size() >= sizeof(header)) memcpy(&header, file.data(), sizeof(header));
+
+	if (file.size() < sizeof(header) || !isValid(header, file)) {
+		err << "Error: File " << path << " is not a compiled program or was compiled by a different version." << endl;
+		return false;
+	}
+
+	memcpy(outRes.regs, header.regs, sizeof(outRes.regs));
+	outRes.dataMem.load(file.data() + header.memOffset, header.memSize);
+
+	// The file is mapped at the start of a page, so the code section is aligned and executed in place.
+	const simulator::decodedInstr *code = (const simulator::decodedInstr *)(file.data() + header.codeOffset);
+	const textRecord *text = (const textRecord *)(file.data() + header.textOffset);
+	const char *strings = file.data() + header.stringsOffset;
+	uint32_t codeCnt = header.codeCnt;
+
+	// The texts are only needed for printing, which most large runs do not do.
+	outRes.setImage(span(code, codeCnt), mapped, [code, text, strings, codeCnt](vector<simulator::instruction> &codeText) {
+		codeText.resize(codeCnt);
+
+		for (uint32_t i = 0; i < codeCnt; i++) {
+			simulator::instruction &instr = codeText[i];
+			(simulator::decodedInstr &)instr = code[i];
+			instr.label = strings + text[i].label;
+			instr.displayName = strings + text[i].displayName;
+			instr.labelOp = strings + text[i].labelOp;
+		}
+	});
+
+	return true;
+}
+} // namespace translator
@@ -0,0 +1,337 @@
+#include "renderer.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace renderer
+{
+diagram::diagram(ostream &out, vector<simulator::instruction> &codeText, bool useRegularNOPs, bool useTabs,
+				 bool statsOnly, bool compressLoops, simulator::forwardingType forwarding)
+	: out(out), codeText(codeText), useRegularNOPs(useRegularNOPs && !statsOnly), useTabs(useTabs),
+	  statsOnly(statsOnly), stallsDec(forwarding != simulator::forwardingType::FULL),
+	  compressLoops(compressLoops && !useRegularNOPs && !statsOnly)
+{
+	if (statsOnly) return;
+
+	nop.displayName = "NOP";
+	nop.type = simulator::instrType::NOP;
+	nop.op = simulator::operation::NONE;
+
+	for (simulator::instruction &instr : codeText) {
+		uint labellen = instr.label.length();
+		if (instrcol < labellen) instrcol = labellen;
+	}
+
+	if (useRegularNOPs) return;
+
+	instrTexts.reserve(codeText.size());
+
+	for (simulator::instruction &instr : codeText) {
+		instrTexts.push_back(instr.toString(instrcol));
+
+		uint instrlen = instrTexts.back().length();
+		if (diagramStart < instrlen) diagramStart = instrlen;
+	}
+}
+
+void diagram::addInstr(const simulator::timing &t)
+{
+	uint x = t.execute;
+	lastpos = x + 3;
+	instrCnt++;
+
+	if (statsOnly) return;
+
+	simulator::instruction &instr = codeText[t.idx];
+
+	if (useRegularNOPs) {
+		// Every cycle without an instruction in the execution phase needs a NOP.
+		for (uint i = lastExecute + 1; i < x; i++)
+			out << nop.toString(instrcol) << '\n';
+
+		out << instr.toString(instrcol) << '\n';
+		lastExecute = x;
+		lastPenalty = t.penalty;
+		return;
+	}
+
+	// Columns of the fetch and decode phases. Stalls are placed between them or after the decode phase.
+	uint fcol, dcol, stallStart, stallEnd;
+
+	if (lastBranch) { // Nothing is fetched until the branch is resolved.
+		fcol = x - 2;
+		dcol = x - 1;
+		stallStart = fetchpos;
+		stallEnd = fcol;
+	} else if (stallsDec) {
+		fcol = t.decode - 1;
+		dcol = x - 1;
+		stallStart = t.decode;
+		stallEnd = dcol;
+	} else {
+		// Fetches waiting for the previous instruction to leave the decode phase are not shown.
+		fcol = max(t.fetch, fetchpos);
+		dcol = t.decode;
+		stallStart = dcol + 1;
+		stallEnd = x;
+	}
+
+	diagramRow row = {.idx = t.idx,
+					  .fcol = fcol,
+					  .dcol = dcol,
+					  .stallStart = stallStart,
+					  .stallEnd = stallEnd,
+					  .execute = x};
+
+	fetchpos = dcol;
+	lastBranch = instr.type == simulator::instrType::BRA1 || instr.type == simulator::instrType::BRA2 ||
+				 instr.type == simulator::instrType::J;
+
+	if (!compressLoops) {
+		printRow(row);
+		return;
+	}
+
+	if (!iteration.empty() && (t.idx <= iteration.back().idx || iteration.size() >= maxIterationRows)) {
+		if (iteration.size() >= maxIterationRows) lastIteration.clear(); // Cut, so it can't be compared.
+		endIteration(isRepeated());
+	}
+
+	iteration.push_back(row);
+
+	// A repetition is known as soon as it has as many rows as the previous iteration, even if the loop ends after it.
+	if (iteration.size() == lastIteration.size() && isRepeated()) endIteration(true);
+}
+
+void diagram::printRow(const diagramRow &row)
+{
+	const string &instrStr = instrTexts[row.idx];
+	line.assign(instrStr);
+	line.append(diagramStart - instrStr.length() + 5, ' ');
+
+	if (useTabs) line += '\t';
+
+	for (uint pos = shift; pos < row.execute; pos++) {
+		char phase = ' ';
+
+		if (pos == row.fcol) {
+			phase = 'F';
+		} else if (pos == row.dcol) {
+			phase = 'D';
+		} else if (pos >= row.stallStart && pos < row.stallEnd) {
+			phase = 'S';
+		}
+
+		if (phase == ' ') {
+			line += useTabs ? "\t" : "   ";
+		} else {
+			line += phase;
+			line += useTabs ? "\t" : "  ";
+		}
+	}
+
+	line += useTabs ? "X\tM\tW\n" : "X  M  W\n";
+	out.write(line.data(), line.size());
+}
+
+bool diagram::isRepeated() const
+{
+	if (iteration.size() != lastIteration.size() || iteration.empty()) return false;
+
+	// Differences between unsigned columns still match when they wrap around.
+	uint base = iteration.front().execute, lastBase = lastIteration.front().execute;
+
+	return equal(iteration.begin(), iteration.end(), lastIteration.begin(),
+				 [&](const diagramRow &a, const diagramRow &b) {
+					 return a.idx == b.idx && a.fcol - base == b.fcol - lastBase &&
+							a.dcol - base == b.dcol - lastBase && a.stallStart - base == b.stallStart - lastBase &&
+							a.stallEnd - base == b.stallEnd - lastBase && a.execute - base == b.execute - lastBase;
+				 });
+}
+
+void diagram::endIteration(bool repeated)
+{
+	if (repeated) {
+		uint cycles = iteration.front().execute - lastIteration.front().execute;
+		repeats++;
+		repeatedCycles += cycles;
+		shift += cycles;
+	} else {
+		printRepeats();
+
+		for (const diagramRow &row : iteration)
+			printRow(row);
+	}
+
+	lastIteration.swap(iteration);
+	iteration.clear();
+}
+
+void diagram::printRepeats()
+{
+	if (repeats == 0) return;
+
+	out << string(instrcol + 3, ' ') << "(Last iteration repeated " << repeats << (repeats == 1 ? " time, " : " times, ")
+		<< repeatedCycles << " cycles not shown)\n";
+
+	repeats = 0;
+	repeatedCycles = 0;
+}
+
+diagramState diagram::getState() const
+{
+	return {.fetchpos = fetchpos,
+			.lastpos = lastpos,
+			.lastExecute = lastExecute,
+			.lastPenalty = lastPenalty,
+			.instrCnt = instrCnt,
+			.lastBranch = lastBranch};
+}
+
+void diagram::setState(const diagramState &state)
+{
+	fetchpos = state.fetchpos;
+	lastpos = state.lastpos;
+	lastExecute = state.lastExecute;
+	lastPenalty = state.lastPenalty;
+	instrCnt = state.instrCnt;
+	lastBranch = state.lastBranch;
+}
+
+void diagram::finish()
+{
+	if (compressLoops) {
+		if (!iteration.empty()) endIteration(isRepeated());
+		printRepeats();
+	}
+
+	if (useRegularNOPs) {
+		// Branch and jump penalties still need NOPs at the end of the program.
+		for (; lastPenalty > 0; lastPenalty--)
+			out << nop.toString(instrcol) << '\n';
+
+		out.flush();
+		return;
+	}
+
+	float cpi = instrCnt > 0 ? (float)lastpos / instrCnt : 0;
+
+	if (statsOnly) {
+		// Every cycle in which no instruction got to the execution phase is a stall, apart from the fetch and
+		// decode phases of the first instruction and the memory and write-back phases of the last one.
+		uint stallCnt = instrCnt > 0 ? lastpos - 4 - instrCnt : 0;
+
+		out << "Instructions: " << instrCnt << "\nStalls: " << stallCnt << "\nCycles: " << lastpos
+			<< "\nAverage CPI: " << lastpos << '/' << instrCnt << " = " << cpi << endl;
+		return;
+	}
+
+	out << "\nCycles: " << lastpos << "\nAverage CPI: " << lastpos << '/' << instrCnt << " = " << cpi << endl;
+}
+
+void printSweep(ostream &out, const vector<simulator::sweepResult> &results)
+{
+	// Same names as the values of the command-line options.
+	static const char *forwardingNames[] = {"no", "full", "alu"};
+	static const char *branchPredNames[] = {"no", "p", "t", "nt", "1bit", "2bit", "gshare"};
+
+	out << left << setw(12) << "Forwarding" << setw(8) << "Branch" << setw(15) << "Branch in dec" << right
+		<< setw(14) << "Instructions" << setw(10) << "Stalls" << setw(10) << "Cycles" << setw(10) << "CPI" << '\n';
+
+	for (const simulator::sweepResult &result : results) {
+		out << left << setw(12) << forwardingNames[(int)result.forwarding] << setw(8)
+			<< branchPredNames[(int)result.branchPred] << setw(15) << (result.branchInDec ? "yes" : "no") << right;
+
+		if (result.limitReached) {
+			out << "  Instruction limit reached.\n";
+			continue;
+		}
+
+		uint stallCnt = result.instrCnt > 0 ? result.cycles - 4 - result.instrCnt : 0;
+
+		float cpi = result.instrCnt > 0 ? (float)result.cycles / result.instrCnt : 0;
+
+		out << setw(14) << result.instrCnt << setw(10) << stallCnt << setw(10) << result.cycles << setw(10)
+			<< fixed << setprecision(3) << cpi << defaultfloat << '\n';
+	}
+
+	out.flush();
+}
+
+void printPredictions(ostream &out, const simulator::predictorStats &stats)
+{
+	out << "Branches: " << stats.branches << "\nMispredicted branches: " << stats.mispredicted << fixed
+		<< setprecision(2);
+
+	if (stats.branches > 0)
+		out << "\nPrediction accuracy: " << 100.0 * (stats.branches - stats.mispredicted) / stats.branches << '%';
+
+	if (stats.btbLookups > 0) {
+		out << "\nBranch target buffer hits: " << stats.btbHits << '/' << stats.btbLookups << " = "
+			<< 100.0 * stats.btbHits / stats.btbLookups << '%';
+	}
+
+	out << defaultfloat << "\nJumps: " << stats.jumps << "\nPenalty cycles: " << stats.penaltyCycles << endl;
+}
+
+void printCache(ostream &out, const simulator::cacheStats &stats)
+{
+	uint64_t accesses = stats.loads + stats.stores, misses = stats.loadMisses + stats.storeMisses;
+
+	out << "Data cache accesses: " << accesses << " (loads " << stats.loads << ", stores " << stats.stores
+		<< ")\nData cache hits: " << accesses - misses << "\nData cache misses: " << misses << " (loads "
+		<< stats.loadMisses << ", stores " << stats.storeMisses << ')';
+
+	if (accesses > 0)
+		out << fixed << setprecision(2) << "\nHit rate: " << 100.0 * (accesses - misses) / accesses << '%'
+			<< defaultfloat;
+
+	out << "\nWrite-backs: " << stats.writebacks << endl;
+}
+
+void printSample(ostream &out, const simulator::sampleResult &result)
+{
+	double cpi = result.instrCnt > 0 ? result.cycles / result.instrCnt : 0;
+	double cpiError = result.instrCnt > 0 ? result.cyclesError / result.instrCnt : 0;
+
+	out << "Instructions: " << result.instrCnt << "\nSampled instructions: " << result.sampledCnt << " in "
+		<< result.windows << " windows" << fixed;
+
+	if (isnan(result.cyclesError)) {
+		out << setprecision(0) << "\nEstimated cycles: " << result.cycles << setprecision(3)
+			<< "\nEstimated CPI: " << cpi
+			<< "\nThere are too few windows to know the confidence interval.";
+	} else {
+		out << setprecision(0) << "\nEstimated cycles: " << result.cycles << " +/- " << result.cyclesError
+			<< setprecision(3) << "\nEstimated CPI: " << cpi << " +/- " << cpiError << " (95% confidence)";
+	}
+
+	out << defaultfloat << endl;
+}
+
+void printCores(ostream &out, const vector<simulator::coreResult> &results)
+{
+	uint64_t instrCnt = 0;
+	uint cycles = 0;
+
+	out << left << setw(6) << "Core" << right << setw(14) << "Instructions" << setw(10) << "Stalls" << setw(10)
+		<< "Cycles" << setw(10) << "CPI" << '\n';
+
+	for (uint id = 0; id < results.size(); id++) {
+		const simulator::coreResult &result = results[id];
+		uint stallCnt = result.instrCnt > 0 ? result.cycles - 4 - result.instrCnt : 0;
+		float cpi = result.instrCnt > 0 ? (float)result.cycles / result.instrCnt : 0;
+
+		out << left << setw(6) << id << right << setw(14) << result.instrCnt << setw(10) << stallCnt << setw(10)
+			<< result.cycles << setw(10) << fixed << setprecision(3) << cpi << defaultfloat << '\n';
+
+		instrCnt += result.instrCnt;
+		cycles = max(cycles, result.cycles);
+	}
+
+	// The cores run at the same time, so all of them are done once the slowest one is.
+	double throughput = cycles > 0 ? (double)instrCnt / cycles : 0;
+	out << "Instructions: " << instrCnt << "\nCycles: " << cycles << fixed << setprecision(3)
+		<< "\nThroughput: " << throughput << " instructions per cycle" << defaultfloat << endl;
+}
+} // namespace renderer
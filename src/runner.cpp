@@ -0,0 +1,358 @@
+#include "runner.h"
+#include "checkpoint.h"
+#include "mappedparser.h"
+#include "multicore.h"
+#include "programfile.h"
+#include "renderer.h"
+#include "sampler.h"
+#include "sweep.h"
+#include "threadpool.h"
+#include "tracefile.h"
+#include "translator.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace runner
+{
+// The parser keeps its state in globals.
+static mutex parserLock;
+
+// Prints the access outside of the mapped memory that ended the program, if any, and the core that did it if it is
+// not -1. Returns false if there was one.
+static bool checkFault(simulator::program &prog, const simulator::memoryFault *fault, ostream &err, int core = -1)
+{
+	if (fault == nullptr) return true;
+
+	prog.loadText();
+	err << "Error: Address " << fault->address << " is outside of the " << prog.dataMem.mappedSize()
+		<< " bytes of memory, accessed by instruction " << fault->instr << " ("
+		<< prog.codeText[fault->instr].displayName << ')';
+	if (core >= 0) err << " of core " << core;
+	err << '.' << endl;
+	return false;
+}
+
+// Executes the instructions before the point where the simulation starts, without any timing, leaving pc at the
+// first instruction to simulate.
+static bool skip(simulator::program &prog, const settings &set, simulator::interpreter &interpreter, uint &pc,
+				 ostream &err)
+{
+	uint skipped = 0;
+
+	if (!set.skipLabel.empty()) {
+		prog.loadText();
+		auto it = find_if(prog.codeText.begin(), prog.codeText.end(),
+						  [&](const simulator::instruction &instr) { return instr.label == set.skipLabel; });
+
+		if (it == prog.codeText.end()) {
+			err << "Error: Unknown label " << set.skipLabel << endl;
+			return false;
+		}
+
+		// The label might never be reached, so the same limit as when simulating applies.
+		uint target = it - prog.codeText.begin();
+		skipped = interpreter.runUntil(pc, target, set.instrLimit);
+		if (!checkFault(prog, interpreter.getFault(), err)) return false;
+
+		if (pc != target && pc < prog.code.size()) {
+			err << "Instruction limit reached. Check for infinite loops." << endl;
+			return false;
+		}
+	} else {
+		skipped = interpreter.run(pc, set.skipCount, nullptr);
+		if (!checkFault(prog, interpreter.getFault(), err)) return false;
+	}
+
+	if (pc >= prog.code.size()) {
+		err << "Error: The program finished after " << skipped << " instructions, before the simulation started."
+			<< endl;
+		return false;
+	}
+
+	return true;
+}
+
+result run(simulator::program &prog, const settings &set, ostream &out, ostream &err)
+{
+	result res;
+
+	if (!set.compilePath.empty()) {
+		prog.loadText();
+		res.ok = translator::saveProgram(prog, set.compilePath, err);
+		return res;
+	}
+
+	if (set.checkDispatch) {
+		for (simulator::dispatchType type : {simulator::dispatchType::THREADED, simulator::dispatchType::BLOCK})
+			if (!simulator::interpreter::verify(prog.code, prog.dataMem, prog.regs, type, set.instrLimit, err))
+				return res;
+	}
+
+	if (set.mapMemory && !prog.dataMem.map(set.memorySize)) {
+		err << "Error: The address space of the memory could not be reserved." << endl;
+		return res;
+	}
+
+	if (set.cores > 1) {
+		simulator::coreConfig config = {.cores = set.cores,
+										.quantum = set.quantum,
+										.forwarding = set.forwarding,
+										.branchPred = set.branchPred,
+										.branchInDec = set.branchInDec,
+										.predictor = set.predictor,
+										.dispatch = set.dispatch};
+		vector<simulator::coreResult> results;
+
+		if (!simulator::simulateCores(prog, config, set.instrLimit, set.jobs, results)) {
+			auto faulted =
+				find_if(results.begin(), results.end(), [](const simulator::coreResult &r) { return r.faulted; });
+			checkFault(prog, &faulted->fault, err, faulted - results.begin());
+			return res;
+		}
+
+		if (any_of(results.begin(), results.end(), [](const simulator::coreResult &r) { return r.limitReached; })) {
+			err << "Instruction limit reached. Check for infinite loops." << endl;
+			return res;
+		}
+
+		renderer::printCores(out, results);
+		res.ok = true;
+
+		for (const simulator::coreResult &result : results) {
+			res.instrCnt += result.instrCnt;
+			res.cycles = max(res.cycles, result.cycles);
+		}
+
+		return res;
+	}
+
+	simulator::interpreter interpreter(prog.code, prog.dataMem, prog.regs, set.dispatch);
+	uint pc = 0;
+
+	if ((set.skipCount > 0 || !set.skipLabel.empty()) && !skip(prog, set, interpreter, pc, err)) return res;
+
+	if (set.sweep) {
+		vector<simulator::sweepResult> results;
+
+		if (!simulator::sweep(prog.code, interpreter, pc, set.instrLimit, set.jobs, set.predictor, results)) {
+			err << "Instruction limit reached. Check for infinite loops." << endl;
+			return res;
+		}
+
+		if (!checkFault(prog, interpreter.getFault(), err)) return res;
+
+		renderer::printSweep(out, results);
+		res.ok = true;
+		res.instrCnt = results.front().instrCnt;
+		return res;
+	}
+
+	if (set.samplePeriod > 0) {
+		simulator::sampleConfig config = {.period = set.samplePeriod,
+										  .window = set.sampleWindow,
+										  .warmup = set.sampleWarmup,
+										  .forwarding = set.forwarding,
+										  .branchPred = set.branchPred,
+										  .branchInDec = set.branchInDec,
+										  .predictor = set.predictor};
+		simulator::sampleResult estimate;
+
+		if (!simulator::sample(prog.code, interpreter, pc, config, set.instrLimit, estimate)) {
+			err << "Instruction limit reached. Check for infinite loops." << endl;
+			return res;
+		}
+
+		if (!checkFault(prog, interpreter.getFault(), err)) return res;
+
+		renderer::printSample(out, estimate);
+		res.ok = true;
+		res.instrCnt = estimate.instrCnt;
+		res.cycles = llround(estimate.cycles);
+		return res;
+	}
+
+	// Only the rows of the diagram and the trace print the instructions.
+	if (!set.statsOnly || !set.tracePath.empty()) prog.loadText();
+
+	renderer::diagram diagram(out, prog.codeText, set.useRegularNOPs, set.useTabs, set.statsOnly, set.compressLoops,
+							  set.forwarding);
+	simulator::pipeline pipeline(prog.code, interpreter, set.forwarding, set.branchPred, set.branchInDec, set.predictor,
+								 set.cache, pc, !set.tracePath.empty());
+	unique_ptr<renderer::traceWriter> trace;
+
+	if (!set.tracePath.empty()) {
+		trace = make_unique<renderer::traceWriter>(set.tracePath, prog, set.forwarding, set.branchPred,
+												   set.branchInDec);
+
+		if (!trace->isOpen()) {
+			err << "Error: File " << set.tracePath << " could not be opened for writing." << endl;
+			return res;
+		}
+	}
+
+	// The interpreter uses the registers and the memory of the program, so they can still be replaced.
+	if (!set.restorePath.empty()) {
+		checkpoint state;
+		if (!loadCheckpoint(set.restorePath, set, prog, pipeline, state, err)) return res;
+
+		pipeline.setState(state.pipeline);
+		diagram.setState(state.diagram);
+		res.instrCnt = state.instrCnt;
+		res.cycles = state.cycles;
+	}
+
+	// Execution
+	while (pipeline.step()) {
+		const simulator::timing *executing = pipeline.executing();
+
+		if (executing != nullptr) {
+			// Every cycle since the first instruction got to the execution phase counts, including stalls.
+			if (executing->execute - 2 > set.instrLimit) {
+				err << "Instruction limit reached. Check for infinite loops." << endl;
+				return res;
+			}
+
+			diagram.addInstr(*executing);
+			res.instrCnt++;
+			res.cycles = executing->execute + 3;
+
+			if (trace) trace->addInstr(*executing, pipeline.executingAddress());
+		} else if (trace) {
+			int idx;
+			simulator::stallType stall = pipeline.stalled(idx);
+			trace->addStall(stall, idx, pipeline.cycle - 1);
+		}
+
+		// Only between cycles, once the row of the last instruction has been added.
+		if (!set.checkpointPath.empty() && pipeline.cycle % set.checkpointEvery == 0) {
+			checkpoint state = makeCheckpoint(prog, set, pipeline, diagram, res);
+			if (!saveCheckpoint(set.checkpointPath, state, prog, pipeline, err)) return res;
+		}
+	}
+
+	if (!checkFault(prog, interpreter.getFault(), err)) return res;
+
+	diagram.finish();
+	if (simulator::isDynamic(set.branchPred) && !set.useRegularNOPs)
+		renderer::printPredictions(out, pipeline.predictions());
+
+	if (set.cache.size > 0 && !set.useRegularNOPs) renderer::printCache(out, pipeline.cacheAccesses());
+
+	if (trace && !trace->finish(prog.codeText, set.tracePath, err)) return res;
+
+	res.ok = true;
+	return res;
+}
+
+result runFile(istream &in, const settings &set, ostream &out, ostream &err)
+{
+	simulator::program prog;
+
+	{
+		lock_guard guard(parserLock);
+		if (!translator::loadProgram(in, prog, err)) return result();
+	}
+
+	return run(prog, set, out, err);
+}
+
+result runSource(string_view source, const settings &set, ostream &out, ostream &err)
+{
+	simulator::program prog;
+	if (!translator::loadProgram(source, prog, err)) return result();
+
+	return run(prog, set, out, err);
+}
+
+result runCompiled(const string &path, const settings &set, ostream &out, ostream &err)
+{
+	simulator::program prog;
+	if (!translator::loadCompiled(path, prog, err)) return result();
+
+	return run(prog, set, out, err);
+}
+
+bool runBatch(const vector<string> &files, const string &outDir, const settings &set, ostream &summary)
+{
+	vector<result> results(files.size());
+	vector<string> errors(files.size());
+
+	// Files are already simulated in parallel.
+	settings fileSet = set;
+	fileSet.jobs = 1;
+
+	{
+		parallel::threadPool pool(set.jobs);
+
+		for (uint i = 0; i < files.size(); i++) {
+			pool.submit([&, i] {
+				filesystem::path outPath = filesystem::path(files[i]).replace_extension(".out");
+				if (!outDir.empty()) outPath = filesystem::path(outDir) / outPath.filename();
+
+				ifstream in;
+				parser::mappedFile mapped;
+				ofstream out;
+				ostringstream err;
+
+				bool opened = set.mapInput ? mapped.open(files[i]) : (in.open(files[i]), in.is_open());
+
+				if (!opened) {
+					err << "Error: File " << files[i] << " does not exist or cannot be opened." << endl;
+				} else if (out.open(outPath), !out.is_open()) {
+					err << "Error: File " << outPath.string() << " could not be opened for writing." << endl;
+				} else {
+					try {
+						results[i] = set.mapInput ? runSource(mapped.text(), fileSet, out, err)
+												  : runFile(in, fileSet, out, err);
+					} catch (const exception &e) {
+						err << "Error: " << e.what() << endl;
+					}
+				}
+
+				errors[i] = err.str();
+				if (out.is_open()) out << errors[i];
+			});
+		}
+
+		pool.wait();
+	}
+
+	uint failed = 0;
+
+	summary << left << setw(8) << "Status" << right << setw(14) << "Instructions" << setw(10) << "Cycles" << setw(10)
+			<< "CPI" << "  File\n";
+
+	for (uint i = 0; i < files.size(); i++) {
+		result &res = results[i];
+
+		if (!res.ok) {
+			failed++;
+
+			// Only the first line of the error, the rest is in the output of the file.
+			string error = errors[i].substr(0, errors[i].find('\n'));
+			summary << left << setw(8) << "error" << right << setw(14) << '-' << setw(10) << '-' << setw(10) << '-'
+					<< "  " << files[i] << ": " << error << '\n';
+			continue;
+		}
+
+		summary << left << setw(8) << "ok" << right << setw(14) << res.instrCnt;
+
+		if (res.cycles > 0 && res.instrCnt > 0) {
+			summary << setw(10) << res.cycles << setw(10) << fixed << setprecision(3)
+					<< (float)res.cycles / res.instrCnt << defaultfloat;
+		} else {
+			summary << setw(10) << '-' << setw(10) << '-';
+		}
+
+		summary << "  " << files[i] << '\n';
+	}
+
+	summary << "\nFiles: " << files.size() << "\nFailed: " << failed << endl;
+	return failed == 0;
+}
+} // namespace runner
@@ -0,0 +1,93 @@
+#include "sampler.h"
+#include <cmath>
+
+namespace simulator
+{
+// Cycles between the instructions from skipped on and the ones before them, when replaying the trace with an empty
+// pipeline. An instruction only waits for the ones before it, so they do not depend on what comes after the trace.
+static uint measure(pipeline &pipeline, const vector<int> &trace, uint endPc, uint skipped)
+{
+	pipeline.replay(trace, endPc);
+	uint executed = 0;
+	uint lastExecute = 1; // The first instruction executes in cycle 2 and counts as one cycle after it.
+	uint startExecute = 1;
+
+	while (pipeline.step()) {
+		const timing *executing = pipeline.executing();
+		if (executing == nullptr) continue;
+
+		if (++executed == skipped) startExecute = executing->execute;
+		lastExecute = executing->execute;
+	}
+
+	return lastExecute - startExecute;
+}
+
+bool sample(span<const decodedInstr> code, interpreter &interp, uint pc, const sampleConfig &config, uint limit,
+			sampleResult &outRes)
+{
+	// Same bound as the sweep: every instruction takes at least a cycle.
+	uint64_t maxInstrs = (uint64_t)limit + 1;
+	vector<int> trace;
+
+	// Reused by every window, so that the code is only analyzed once.
+	// The branch predictor only learns from the windows, including their warm-up.
+	pipeline pipeline(code, trace, 0, config.forwarding, config.branchPred, config.branchInDec, config.predictor);
+
+	outRes = sampleResult();
+	uint64_t cycles = 0; // Cycles of the measured instructions.
+	double cpiSum = 0, cpiSquares = 0; // Of the average CPI of every window.
+
+	while (pc < code.size()) {
+		if (outRes.instrCnt >= maxInstrs) return false;
+
+		// The pipeline is really empty where the simulation starts, so the first window needs no warm-up.
+		uint skipped = outRes.instrCnt == 0 ? 0 : config.warmup;
+		uint length = min((uint64_t)skipped + config.window, maxInstrs - outRes.instrCnt);
+
+		trace.resize(length);
+		trace.resize(interp.run(pc, length, trace.data()));
+		outRes.instrCnt += trace.size();
+
+		if (trace.size() > skipped) {
+			uint measured = trace.size() - skipped;
+			uint windowCycles = measure(pipeline, trace, pc, skipped);
+			double cpi = (double)windowCycles / measured;
+
+			cycles += windowCycles;
+			outRes.sampledCnt += measured;
+			outRes.windows++;
+			cpiSum += cpi;
+			cpiSquares += cpi * cpi;
+		}
+
+		// Functional execution up to the next window.
+		uint remaining = config.period - trace.size();
+		if (pc < code.size() && trace.size() == length)
+			outRes.instrCnt += interp.run(pc, min((uint64_t)remaining, maxInstrs - outRes.instrCnt), nullptr);
+	}
+
+	if (outRes.instrCnt == 0) return true;
+
+	// Apart from the time between instructions, the first one needs 2 cycles to get to the execution phase and the
+	// last one 2 more to finish, as when simulating every instruction.
+	double cpi = (double)cycles / outRes.sampledCnt;
+	outRes.cycles = 4 + cpi * outRes.instrCnt;
+
+	// Normal approximation of the mean of the windows, corrected for the part of the program that was measured,
+	// which has no error at all.
+	double measuredPart = (double)outRes.sampledCnt / outRes.instrCnt;
+
+	if (measuredPart >= 1) {
+		outRes.cyclesError = 0;
+	} else if (outRes.windows < 2) {
+		outRes.cyclesError = NAN;
+	} else {
+		uint n = outRes.windows;
+		double variance = max(0.0, (cpiSquares - cpiSum * cpiSum / n) / (n - 1));
+		outRes.cyclesError = 1.96 * sqrt(variance / n * (1 - measuredPart)) * outRes.instrCnt;
+	}
+
+	return true;
+}
+} // namespace simulator
@@ -1,8 +1,127 @@
 #include "simulator.h"
+#include <algorithm>
+#include <cstring>
 #include <string>
 
+#if !WINNT
+#include <sys/mman.h>
+#endif
+
 namespace simulator
 {
+// Reserved after the address space, so that accesses that start at its end and go past it also fault.
+static const uint64_t mappedReserve = ((uint64_t)1 << 32) + memory::pageSize;
+
+memory::memory() : tables(1 << (32 - pageBits - tableBits)) {}
+
+// The last page is not copied, since its data belongs to the other memory.
+memory::memory(const memory &other)
+	: tables(other.tables), pages(other.pages), pageNumbers(other.pageNumbers), used(other.used)
+{
+	if (other.mapped != nullptr) copyPages(other);
+}
+
+memory &memory::operator=(const memory &other)
+{
+	if (this == &other) return *this;
+
+	unmap();
+	tables = other.tables;
+	pages = other.pages;
+	pageNumbers = other.pageNumbers;
+	used = other.used;
+	lastPage = UINT32_MAX;
+	lastData = nullptr;
+
+	if (other.mapped != nullptr) copyPages(other);
+	return *this;
+}
+
+memory::~memory()
+{
+	unmap();
+}
+
+void memory::copyPages(const memory &other)
+{
+	// Pages with only zeros are the same as the ones never accessed.
+	for (uint page = 0; page < other.mappedPages; page++) {
+		const char *data = other.mapped + (uint64_t)page * pageSize;
+		if (any_of(data, data + pageSize, [](char c) { return c != 0; })) memcpy(touch(page), data, pageSize);
+	}
+}
+
+void memory::unmap()
+{
+#if !WINNT
+	if (mapped != nullptr) munmap(mapped, mappedReserve);
+#endif
+	mapped = nullptr;
+	mappedPages = 0;
+}
+
+bool memory::map(uint size)
+{
+#if WINNT
+	return false;
+#else
+	if (mapped != nullptr) return true;
+
+	void *ptr = mmap(nullptr, mappedReserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (ptr == MAP_FAILED) return false;
+
+	uint64_t pageCnt = ((uint64_t)max(size, used) + pageSize - 1) / pageSize;
+	if (pageCnt > 0 && mprotect(ptr, pageCnt * pageSize, PROT_READ | PROT_WRITE) != 0) {
+		munmap(ptr, mappedReserve);
+		return false;
+	}
+
+	// Allocated pages outside of the accessible ones can only contain zeros, since the variables are inside of them.
+	for (uint i = 0; i < pages.size(); i++) {
+		if (pageNumbers[i] < pageCnt)
+			memcpy((char *)ptr + (uint64_t)pageNumbers[i] * pageSize, pages[i].data(), pageSize);
+	}
+
+	tables.assign(tables.size(), {});
+	pages.clear();
+	pageNumbers.clear();
+	lastPage = UINT32_MAX;
+	lastData = nullptr;
+
+	mapped = (char *)ptr;
+	mappedPages = pageCnt;
+	return true;
+#endif
+}
+
+char *memory::touch(uint page)
+{
+	if (mapped != nullptr) return mapped + (uint64_t)page * pageSize;
+
+	vector<uint> &table = tables[page >> tableBits];
+	if (table.empty()) table.assign(1 << tableBits, 0);
+
+	uint &entry = table[page & ((1 << tableBits) - 1)];
+	if (entry == 0) {
+		pages.emplace_back(pageSize, 0);
+		pageNumbers.push_back(page);
+		entry = pages.size();
+	}
+
+	return pages[entry - 1].data();
+}
+
+const char *memory::find(uint page) const
+{
+	if (mapped != nullptr) return page < mappedPages ? mapped + (uint64_t)page * pageSize : nullptr;
+
+	const vector<uint> &table = tables[page >> tableBits];
+	if (table.empty()) return nullptr;
+
+	uint entry = table[page & ((1 << tableBits) - 1)];
+	return entry > 0 ? pages[entry - 1].data() : nullptr;
+}
+
 int memory::add(varDef def)
 {
 	char dataSize;
@@ -17,33 +136,77 @@ int memory::add(varDef def)
 			dataSize = 4;
 	}
 
-	int mod = internalMem.size() % dataSize;
-	if (mod) { // Data alignment
-		internalMem.resize(internalMem.size() + dataSize - mod, 0);
-	}
-
-	int index = internalMem.size();
+	used = (used + dataSize - 1) / dataSize * dataSize; // Data alignment
+	int index = used;
 
+	// Arrays start as zeros, so their pages are not allocated until they are used.
 	if (def.type == simulator::varType::ARRAY) {
-		uint n = dataSize * def.value;
-		internalMem.resize(internalMem.size() + n, 0);
+		used += dataSize * def.value;
 		return index;
 	}
 
-	for (char i = 0; i < dataSize; i++) {
-		char v = def.value >> i * 8;
-		internalMem.push_back(v);
-	}
+	for (char i = 0; i < dataSize; i++)
+		*get<char>(used++) = def.value >> i * 8;
 
 	return index;
 }
 
-void memory::shrink()
+void memory::read(uint idx, char *data, uint size) const
+{
+	for (uint i = 0; i < size;) {
+		uint offset = (idx + i) & (pageSize - 1);
+		uint chunk = min(size - i, pageSize - offset);
+		const char *page = find((idx + i) >> pageBits);
+
+		if (page != nullptr) memcpy(data + i, page + offset, chunk);
+		else memset(data + i, 0, chunk);
+
+		i += chunk;
+	}
+}
+
+void memory::load(const char *data, uint size)
+{
+	*this = memory();
+	used = size;
+
+	// Pages with only zeros are the same as the ones never allocated.
+	for (uint i = 0; i < size; i += pageSize) {
+		uint chunk = min(size - i, pageSize);
+		if (all_of(data + i, data + i + chunk, [](char c) { return c == 0; })) continue;
+
+		memcpy(touch(i >> pageBits), data + i, chunk);
+	}
+}
+
+void memory::loadPage(uint number, const char *data)
 {
-	internalMem.shrink_to_fit();
+	memcpy(touch(number), data, pageSize);
 }
 
-void instruction::execute(memory &mem, int regs[], unordered_map<string, int> &labelMap, uint &pc)
+bool memory::operator==(const memory &other) const
+{
+	// Every page allocated by either of them must have the same contents in the other one, or be all zeros.
+	auto contains = [](const memory &a, const memory &b) -> bool {
+		uint pageCnt = a.mapped != nullptr ? a.mappedPages : a.pages.size();
+
+		for (uint i = 0; i < pageCnt; i++) {
+			uint number = a.mapped != nullptr ? i : a.pageNumbers[i];
+			const char *data = a.find(number);
+			const char *otherData = b.find(number);
+
+			if (otherData != nullptr ? memcmp(data, otherData, pageSize) != 0
+									 : any_of(data, data + pageSize, [](char c) { return c != 0; }))
+				return false;
+		}
+
+		return true;
+	};
+
+	return used == other.used && contains(*this, other) && contains(other, *this);
+}
+
+void decodedInstr::execute(memory &mem, int regs[], uint &pc) const
 {
 	if (type == instrType::UNK || type == instrType::NOP || type == instrType::SNOP || op == operation::NUL) return;
 
@@ -52,7 +215,7 @@ void instruction::execute(memory &mem, int regs[], unordered_map<string, int> &l
 
 	switch (type) {
 		case instrType::J:
-			pc = labelMap[labelOp] - 1; // - 1 because it increments after every instruction
+			pc = target - 1; // - 1 because it increments after every instruction
 			return;
 
 		case instrType::R3:
@@ -123,37 +286,28 @@ void instruction::execute(memory &mem, int regs[], unordered_map<string, int> &l
 			switch (flags.size) {
 
 				case dataSize::WORD: {
-					int *memptr = mem.get<int>(op1 + op2);
-					if (memptr == nullptr) return;
-
 					if (memWrite)
-						*memptr = *resptr;
+						mem.store<int>(op1 + op2, *resptr);
 					else
-						*resptr = *memptr;
+						*resptr = mem.load<int>(op1 + op2);
 
 					break;
 				}
 
 				case dataSize::HALF: {
-					short *memptr = mem.get<short>(op1 + op2);
-					if (memptr == nullptr) return;
-
 					if (memWrite)
-						*memptr = *resptr;
+						mem.store<short>(op1 + op2, *resptr);
 					else
-						*resptr = *memptr;
+						*resptr = mem.load<short>(op1 + op2);
 
 					break;
 				}
 
 				case dataSize::BYTE: {
-					char *memptr = mem.get<char>(op1 + op2);
-					if (memptr == nullptr) return;
-
 					if (memWrite)
-						*memptr = *resptr;
+						mem.store<char>(op1 + op2, *resptr);
 					else
-						*resptr = *memptr;
+						*resptr = mem.load<char>(op1 + op2);
 
 					break;
 				}
@@ -189,10 +343,10 @@ void instruction::execute(memory &mem, int regs[], unordered_map<string, int> &l
 			break;
 	}
 
-	if (jump) pc = labelMap[labelOp] - 1; // - 1 because it increments after every instruction
+	if (jump) pc = target - 1; // - 1 because it increments after every instruction
 }
 
-pipPhase instruction::calcRSNeeded()
+pipPhase decodedInstr::calcRSNeeded() const
 {
 	switch (type) {
 		case instrType::R3:
@@ -207,7 +361,7 @@ pipPhase instruction::calcRSNeeded()
 	}
 }
 
-pipPhase instruction::calcRTNeeded()
+pipPhase decodedInstr::calcRTNeeded() const
 {
 	switch (type) {
 		case instrType::R3:
@@ -222,7 +376,7 @@ pipPhase instruction::calcRTNeeded()
 	}
 }
 
-pipPhase instruction::calcResultDone()
+pipPhase decodedInstr::calcResultDone() const
 {
 	switch (type) {
 		case instrType::R3:
@@ -237,7 +391,7 @@ pipPhase instruction::calcResultDone()
 	}
 }
 
-regType instruction::getRegWritten()
+regType decodedInstr::getRegWritten() const
 {
 	switch (type) {
 		case instrType::R3:
@@ -296,4 +450,50 @@ string instruction::toString(uint minCol)
 	return res;
 }
 
+program::program(const program &other)
+	: ownedCode(other.ownedCode), image(other.image), textLoader(other.textLoader), dataMem(other.dataMem),
+	  codeText(other.codeText)
+{
+	copy(other.regs, other.regs + 32, regs);
+	code = image ? other.code : span<const decodedInstr>(ownedCode);
+}
+
+program &program::operator=(const program &other)
+{
+	if (this == &other) return *this;
+
+	ownedCode = other.ownedCode;
+	image = other.image;
+	textLoader = other.textLoader;
+	dataMem = other.dataMem;
+	copy(other.regs, other.regs + 32, regs);
+	codeText = other.codeText;
+	code = image ? other.code : span<const decodedInstr>(ownedCode);
+	return *this;
+}
+
+void program::setCode(vector<decodedInstr> instrs)
+{
+	ownedCode = move(instrs);
+	image.reset();
+	textLoader = nullptr;
+	code = ownedCode;
+}
+
+void program::setImage(span<const decodedInstr> instrs, shared_ptr<const void> owner,
+					   function<void(vector<instruction> &)> loader)
+{
+	ownedCode.clear();
+	image = move(owner);
+	textLoader = move(loader);
+	code = instrs;
+}
+
+void program::loadText()
+{
+	if (!textLoader) return;
+
+	textLoader(codeText);
+	textLoader = nullptr;
+}
 } // namespace simulator
@@ -0,0 +1,115 @@
+#include "sweep.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <memory>
+
+namespace simulator
+{
+// Instructions executed at once before the pipelines of every configuration simulate them, so that the memory taken
+// by the recording does not grow with the length of the program.
+static const uint chunkSize = 1 << 16;
+
+// One of the configurations, with the instructions its pipeline has not fetched yet.
+class configRun
+{
+  public:
+	sweepResult &result;
+	vector<int> trace;
+	pipeline pipe;
+	uint lastExecute = 0;
+	bool done = false;
+
+	configRun(span<const decodedInstr> code, uint pc, const predictorConfig &predictor, sweepResult &result)
+		: result(result),
+		  pipe(code, trace, pc, result.forwarding, result.branchPred, result.branchInDec, predictor)
+	{
+	}
+};
+
+// Simulates cycles of a configuration until its pipeline needs the next chunk or it finishes.
+static void simulate(configRun &run, uint limit)
+{
+	while (!run.pipe.needsTrace()) {
+		if (!run.pipe.step()) {
+			// Counts up to the write-back phase of the last instruction.
+			run.result.cycles = run.result.instrCnt > 0 ? run.lastExecute + 3 : 0;
+			run.done = true;
+			return;
+		}
+
+		const timing *executing = run.pipe.executing();
+		if (executing == nullptr) continue;
+
+		// Same limit as when simulating a single configuration.
+		if (executing->execute - 2 > limit) {
+			run.result.limitReached = true;
+			run.done = true;
+			return;
+		}
+
+		run.result.instrCnt++;
+		run.lastExecute = executing->execute;
+	}
+}
+
+bool sweep(span<const decodedInstr> code, interpreter &interp, uint pc, uint limit, uint threads,
+		   const predictorConfig &predictor, vector<sweepResult> &results)
+{
+	results.clear();
+
+	for (forwardingType forwarding : {forwardingType::NONE, forwardingType::ALU, forwardingType::FULL}) {
+		for (branchPredType branchPred : {branchPredType::NONE, branchPredType::PERFECT, branchPredType::TAKEN,
+										  branchPredType::NOT_TAKEN, branchPredType::ONE_BIT, branchPredType::TWO_BIT,
+										  branchPredType::GSHARE}) {
+			for (bool branchInDec : {false, true})
+				results.push_back({.forwarding = forwarding, .branchPred = branchPred, .branchInDec = branchInDec});
+		}
+	}
+
+	vector<unique_ptr<configRun>> runs;
+	for (sweepResult &result : results)
+		runs.push_back(make_unique<configRun>(code, pc, predictor, result));
+
+	// Each instruction enters the execution phase at least one cycle after the previous one, so the instruction
+	// after limit + 1 of them is always over the limit.
+	uint64_t maxInstrs = (uint64_t)limit + 1;
+	uint64_t executed = 0;
+	vector<int> chunk;
+
+	parallel::threadPool pool(threads);
+
+	while (any_of(runs.begin(), runs.end(), [](const unique_ptr<configRun> &run) { return !run->done; })) {
+		if (pc < code.size()) {
+			if (executed >= maxInstrs) return false;
+
+			chunk.resize(min((uint64_t)chunkSize, maxInstrs - executed));
+			chunk.resize(interp.run(pc, chunk.size(), chunk.data()));
+			executed += chunk.size();
+
+			// Every pipeline keeps what it has not fetched yet, followed by the new chunk.
+			for (unique_ptr<configRun> &run : runs) {
+				if (run->done) continue;
+
+				run->trace.erase(run->trace.begin(), run->trace.end() - run->pipe.pending());
+				run->trace.insert(run->trace.end(), chunk.begin(), chunk.end());
+				run->pipe.extend(run->trace, pc);
+			}
+		}
+
+		for (unique_ptr<configRun> &run : runs) {
+			if (!run->done) pool.submit([&run, limit] { simulate(*run, limit); });
+		}
+
+		pool.wait();
+	}
+
+	// Every configuration may have gone over the limit before the program finished, which still has to finish
+	// within it.
+	while (pc < code.size()) {
+		if (executed >= maxInstrs) return false;
+		executed += interp.run(pc, min((uint64_t)chunkSize, maxInstrs - executed), nullptr);
+	}
+
+	return true;
+}
+} // namespace simulator
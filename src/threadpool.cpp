@@ -0,0 +1,96 @@
+#include "threadpool.h"
+
+namespace parallel
+{
+threadPool::threadPool(uint threads)
+{
+	if (threads == 0) threads = max(thread::hardware_concurrency(), 1u);
+
+	for (uint i = 0; i < threads; i++)
+		queues.push_back(make_unique<taskQueue>());
+
+	for (uint i = 0; i < threads; i++)
+		workers.emplace_back(&threadPool::work, this, i);
+}
+
+threadPool::~threadPool()
+{
+	{
+		lock_guard guard(idleLock);
+		stopping = true;
+	}
+
+	taskReady.notify_all();
+
+	for (thread &worker : workers)
+		worker.join();
+}
+
+void threadPool::submit(function<void()> task)
+{
+	taskQueue &queue = *queues[nextQueue++ % queues.size()];
+
+	// Counted before being queued, so that waiting threads never miss it.
+	{
+		lock_guard guard(idleLock);
+		pending++;
+		queued++;
+	}
+
+	{
+		lock_guard guard(queue.lock);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	taskReady.notify_one();
+}
+
+void threadPool::wait()
+{
+	unique_lock guard(idleLock);
+	allDone.wait(guard, [this] { return pending == 0; });
+}
+
+bool threadPool::take(uint self, function<void()> &task)
+{
+	for (uint i = 0; i < queues.size(); i++) {
+		taskQueue &queue = *queues[(self + i) % queues.size()];
+		lock_guard guard(queue.lock);
+
+		if (queue.tasks.empty()) continue;
+
+		if (i == 0) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		} else {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+
+		queued--;
+		return true;
+	}
+
+	return false;
+}
+
+void threadPool::work(uint self)
+{
+	while (true) {
+		function<void()> task;
+
+		if (!take(self, task)) {
+			unique_lock guard(idleLock);
+			taskReady.wait(guard, [this] { return stopping || queued > 0; });
+
+			if (queued == 0) return;
+			continue;
+		}
+
+		task();
+
+		lock_guard guard(idleLock);
+		if (--pending == 0) allDone.notify_all();
+	}
+}
+} // namespace parallel
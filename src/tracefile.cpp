@@ -0,0 +1,120 @@
+#include "tracefile.h"
+#include <algorithm>
+#include <cstring>
+
+namespace renderer
+{
+traceWriter::traceWriter(const string &path, const simulator::program &prog, simulator::forwardingType forwarding,
+						 simulator::branchPredType branchPred, bool branchInDec)
+	: file(path, ios::binary), writer(file), code(prog.code)
+{
+	memcpy(header.magic, traceMagic, sizeof(traceMagic));
+	header.version = traceVersion;
+	header.recordSize = sizeof(traceRecord);
+	header.codeCnt = prog.code.size();
+	header.forwarding = (uint8_t)forwarding;
+	header.branchPred = (uint8_t)branchPred;
+	header.branchInDec = branchInDec;
+	header.recordOffset = sizeof(traceHeader);
+
+	// Written again with the counts at the end.
+	writeHeader();
+}
+
+void traceWriter::writeHeader()
+{
+	traceHeader converted = header;
+	converted.convert();
+	file.write((const char *)&converted, sizeof(converted));
+}
+
+bool traceWriter::isOpen() const
+{
+	// The state of the stream is cleared when the writer takes its buffer, but the file stays closed.
+	return file.is_open();
+}
+
+void traceWriter::addInstr(const simulator::timing &t, uint address)
+{
+	const simulator::decodedInstr &instr = code[t.idx];
+	traceRecord record = {.kind = traceKind::INSTR,
+						  .stall = (uint8_t)simulator::stallType::NONE,
+						  .branch = traceBranch::NONE,
+						  .penalty = (uint8_t)t.penalty,
+						  .idx = t.idx,
+						  .fetch = t.fetch,
+						  .decode = t.decode,
+						  .execute = t.execute,
+						  .memory = t.execute + 1,
+						  .writeback = t.execute + 2,
+						  .address = 0};
+
+	if (instr.type == simulator::instrType::BRA1 || instr.type == simulator::instrType::BRA2 ||
+		instr.type == simulator::instrType::J)
+		record.branch = t.taken ? traceBranch::TAKEN : traceBranch::NOT_TAKEN;
+
+	if (instr.type == simulator::instrType::MEM) {
+		record.kind = instr.op == simulator::operation::S ? traceKind::STORE : traceKind::LOAD;
+		record.address = address;
+	}
+
+	// Stalls are only recorded between two instructions, as they are counted in the statistics.
+	if (header.instrCnt > 0) {
+		file.write((const char *)stalls.data(), stalls.size() * sizeof(traceRecord));
+		header.recordCnt += stalls.size();
+	}
+
+	stalls.clear();
+	record.convert();
+	file.write((const char *)&record, sizeof(record));
+	header.recordCnt++;
+	header.instrCnt++;
+	header.cycles = t.execute + 3;
+}
+
+void traceWriter::addStall(simulator::stallType type, int idx, uint cycle)
+{
+	stalls.push_back({.kind = traceKind::STALL,
+					  .stall = (uint8_t)type,
+					  .branch = traceBranch::NONE,
+					  .penalty = 0,
+					  .idx = idx,
+					  .fetch = 0,
+					  .decode = 0,
+					  .execute = cycle,
+					  .memory = 0,
+					  .writeback = 0,
+					  .address = 0});
+
+	stalls.back().convert();
+}
+
+bool traceWriter::finish(vector<simulator::instruction> &codeText, const string &path, ostream &err)
+{
+	bool written = writer.close();
+
+	header.textOffset = header.recordOffset + header.recordCnt * sizeof(traceRecord);
+
+	// Aligned after the longest label, as in the diagram.
+	uint labelCol = 0;
+	for (simulator::instruction &instr : codeText)
+		labelCol = max(labelCol, (uint)instr.label.length());
+
+	for (simulator::instruction &instr : codeText) {
+		string text = instr.toString(labelCol);
+		file.write(text.c_str(), text.size() + 1);
+		header.textSize += text.size() + 1;
+	}
+
+	file.seekp(0);
+	writeHeader();
+	file.flush();
+
+	if (!written || !file.good()) {
+		err << "Error: File " << path << " could not be written." << endl;
+		return false;
+	}
+
+	return true;
+}
+} // namespace renderer
@@ -1,4 +1,5 @@
 #include "translator.h"
+#include "mappedparser.h"
 #include <cstdint>
 #include <string>
 
@@ -17,12 +18,12 @@ bool toVarDef(instruction &instr, simulator::varDef &outRes, ostream &err)
 		return false;
 	}
 
-	if (instr.op.ptr == nullptr || instr.op.type != OPIM) {
+	if (instr.op.type != OPIM) {
 		err << "Error: Variable definitions requires an immediate value." << endl;
 		return false;
 	}
 
-	if (instr.rcount != 1 || instr.rlist == nullptr) {
+	if (instr.rcount != 1) {
 		err << "Error: Variable definitions require one register to store address." << endl;
 		return false;
 	}
@@ -43,7 +44,7 @@ bool toVarDef(instruction &instr, simulator::varDef &outRes, ostream &err)
 		return false;
 	}
 
-	outRes.value = *(uint *)instr.op.ptr;
+	outRes.value = instr.op.im;
 
 	switch (name[2]) {
 		case 'F':
@@ -107,7 +108,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 	int length = name.length(); // We assume length > 0 always thanks to parser code
 
 	auto checkLabel = [&instr, &name, &err]() -> bool {
-		if (instr.op.ptr == nullptr || instr.op.type != OPLABEL) {
+		if (instr.op.type != OPLABEL) {
 			err << "Error: Instruction " << name << " requires a label as operand." << endl;
 			return false;
 		}
@@ -116,7 +117,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 	};
 
 	auto checkIndirect = [&instr, &name, &err]() -> bool {
-		if (instr.op.ptr == nullptr || instr.op.type != OPINDIRECT) {
+		if (instr.op.type != OPINDIRECT) {
 			err << "Error: Instruction " << name << " requires a register indirect operand." << endl;
 			return false;
 		}
@@ -125,7 +126,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 	};
 
 	auto checkImmediate = [&instr, &name, &err]() -> bool {
-		if (instr.op.ptr == nullptr || instr.op.type != OPIM) {
+		if (instr.op.type != OPIM) {
 			err << "Error: Instruction " << name << " requires an immediate operand." << endl;
 			return false;
 		}
@@ -179,7 +180,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 		indirect indir;
 
 		case OPINDIRECT:
-			indir = *(indirect *)instr.op.ptr;
+			indir = instr.op.indir;
 
 			if ((uint)indir.reg > 31) {
 				errorUnkReg(indir.reg);
@@ -194,7 +195,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 			break;
 
 		case OPIM:
-			im = *(int *)instr.op.ptr;
+			im = instr.op.im;
 
 			if (im != (short)im) {
 				err << "Warning: Instruction " << name << " immediate operand has overflown. Actual value:" << (short)im
@@ -247,7 +248,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 				}
 			}
 
-			indir = *(indirect *)instr.op.ptr;
+			indir = instr.op.indir;
 			outRes.im = indir.im;
 			outRes.rS = indir.reg;
 
@@ -278,7 +279,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 			}
 
 			if (!checkLabel()) return false;
-			outRes.labelOp = string((char *)instr.op.ptr);
+			outRes.labelOp = string(instr.op.label);
 
 			if (outRes.label == outRes.labelOp) {
 				err << "Error: Branches cannot have their own label as an operand." << endl;
@@ -337,7 +338,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 
 			outRes.type = simulator::instrType::J;
 			outRes.op = simulator::operation::NONE;
-			outRes.labelOp = string((char *)instr.op.ptr);
+			outRes.labelOp = string(instr.op.label);
 
 			return true;
 	}
@@ -467,7 +468,7 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 
 		outRes.rT = instr.rlist[0];
 		outRes.rS = instr.rlist[1];
-		outRes.im = *(int *)instr.op.ptr;
+		outRes.im = instr.op.im;
 
 		if (outRes.rT == 0) {
 			errorRZero();
@@ -493,4 +494,105 @@ bool toInstruction(instruction &instr, simulator::instruction &outRes, ostream &
 
 	return true;
 }
+
+bool toDecoded(simulator::instruction &instr, unordered_map<string, int> &labelMap, simulator::decodedInstr &outRes,
+			   ostream &err)
+{
+	outRes = instr;
+	outRes.target = -1;
+
+	if (instr.labelOp.empty()) return true;
+
+	auto it = labelMap.find(instr.labelOp);
+	if (it == labelMap.end()) {
+		err << "Error: reference to unknown label " << instr.labelOp << '.' << endl;
+		return false;
+	}
+
+	outRes.target = it->second;
+	return true;
+}
+
+bool translateProgram(vector<instruction> &instrs, simulator::program &outRes, ostream &err)
+{
+	uint line = 0;
+
+	// Variable declarations
+	for (; line < instrs.size(); line++) {
+		instruction instr = instrs[line];
+		simulator::varDef varDef;
+
+		if (!isVarDef(instr)) break;
+
+		if (!toVarDef(instr, varDef, err)) {
+			err << "Error happened at instruction " << line + 1 << endl;
+			return false;
+		}
+
+		outRes.regs[varDef.reg] = outRes.dataMem.add(varDef);
+	}
+
+	uint codeStart = line;
+	int codeSize = instrs.size() - line;
+
+	outRes.codeText.resize(codeSize);
+	vector<simulator::decodedInstr> code(codeSize);
+	unordered_map<string, int> labelMap;
+
+	// Instructions
+	for (int i = 0; line < instrs.size(); line++, i++) {
+		instruction instr = instrs[line];
+		simulator::instruction instruction;
+
+		if (isVarDef(instr)) {
+			err << "Error: Cannot define a variable in execution time. Instruction " << line + 1 << endl;
+			return false;
+		}
+
+		if (!toInstruction(instr, instruction, err)) {
+			err << "Error happened at instruction " << line + 1 << endl;
+			return false;
+		}
+
+		if (!instruction.label.empty()) {
+			if (labelMap.contains(instruction.label)) {
+				err << "Error: cannot have the same label for more than one instruction. Instruction " << line + 1
+					<< " for label " << instruction.label << endl;
+				return false;
+			}
+
+			labelMap[instruction.label] = i;
+		}
+
+		outRes.codeText[i] = instruction;
+	}
+
+	// Labels can only be resolved once all of them are known.
+	for (int i = 0; i < codeSize; i++) {
+		if (!toDecoded(outRes.codeText[i], labelMap, code[i], err)) {
+			err << "Error happened at instruction " << codeStart + i + 1 << endl;
+			return false;
+		}
+	}
+
+	outRes.setCode(move(code));
+	return true;
+}
+
+bool loadProgram(istream &in, simulator::program &outRes, ostream &err)
+{
+	vector<instruction> instrs = parse(&in, &err);
+	bool correct = translateProgram(instrs, outRes, err);
+
+	freeResources(); // Frees resources from the parser
+	return correct;
+}
+
+bool loadProgram(string_view source, simulator::program &outRes, ostream &err)
+{
+	mappedParser parser;
+	vector<instruction> instrs = parser.parse(source, err);
+
+	return translateProgram(instrs, outRes, err);
+}
 } // namespace translator
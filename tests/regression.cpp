@@ -0,0 +1,691 @@
+// Checks that every way of simulating a program other than a plain run of a single configuration gives the same
+// results as that run, and that both front ends load the same program. Prints a line per check and returns a non-zero
+// status if any of them failed.
+
+#include "mappedparser.h"
+#include "multicore.h"
+#include "runner.h"
+#include "sweep.h"
+#include "tracefile.h"
+#include "translator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using simulator::branchPredType;
+using simulator::forwardingType;
+
+// Loops over a vector, storing to it and branching on what it loads. Every core works on its own quarter of it, and
+// the number of instructions and the branches taken do not depend on which one, so all of them behave like a single
+// core. It takes a few thousand cycles, enough for several checkpoints, windows and quanta.
+static const string_view loopSource = R"(DEVW $20, 1024
+		ADD   $8, $26, $26
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $8, $8, $8
+		ADD   $20, $20, $8
+		ADDI  $16, $0, 12
+OUTER:	ADDI  $17, $0, 64
+		ADD   $3, $20, $0
+INNER:	LW    $5, 0($3)
+		ADD   $5, $5, $17
+		SW    $5, 0($3)
+		ANDI  $6, $5, 3
+		BEQ   $6, $0, SKIP
+		XOR   $7, $7, $5
+		LB    $9, 1($3)
+SKIP:	ADDI  $3, $3, 4
+		ADDI  $17, $17, -1
+		BNE   $17, $0, INNER
+		ADDI  $16, $16, -1
+		BGTZ  $16, OUTER
+)";
+
+// Counts down in a loop, with a hazard in every iteration. Has no memory.
+static const string_view countSource = R"(		ADDI  $4, $0, 1
+		ADDI  $2, $0, 300
+LOOP:	SUB   $2, $2, $4
+		BNE   $4, $2, LOOP
+		XOR   $1, $4, $2
+)";
+
+// Loads and stores words and halves that are split between the first two pages of the memory, and loops forever if
+// any of them goes wrong. Otherwise it executes splitInstrCnt instructions.
+static const string_view splitSource = R"(DEVW $1, 2048
+		ADDI  $2, $0, 4094
+		ADDI  $3, $0, 30292
+		ADD   $3, $3, $3
+		ADD   $3, $3, $3
+		ADD   $3, $3, $3
+		ADD   $3, $3, $3
+		ADD   $3, $3, $3
+		ADD   $3, $3, $3
+		ADD   $3, $3, $3
+		ADD   $3, $3, $3
+		ORI   $3, $3, 33
+		SW    $3, 0($2)
+		LW    $4, 0($2)
+		BNE   $4, $3, BAD
+		LH    $5, 1($2)
+		ADDI  $10, $0, 30292
+		BNE   $5, $10, BAD
+		LB    $6, 2($2)
+		ADDI  $10, $0, 118
+		BNE   $6, $10, BAD
+		SH    $3, 1($2)
+		LB    $6, 2($2)
+		ADDI  $10, $0, 84
+		BNE   $6, $10, BAD
+		J     END
+BAD:	J     BAD
+END:	ADDI  $1, $0, 1
+)";
+static const uint splitInstrCnt = 26;
+
+// Go over the end of a mapped memory with a load and with a store, which the error must name.
+static const string_view loadFaultSource = R"(DEFW $1, 0
+DEVW $2, 1024
+DEFW $3, 0
+		ADDI  $4, $0, 1
+loop:	LW    $5, 0($1)
+		SW    $4, 0($2)
+		LW    $6, 4($2)
+		ADDI  $2, $2, 4
+		ADDI  $4, $4, 1
+		BNE   $4, $0, loop
+)";
+
+static const string_view storeFaultSource = R"(DEVW $2, 1024
+		ADDI  $4, $0, 1
+loop:	ADDI  $4, $4, 1
+		SB    $4, 1($2)
+		ADDI  $2, $2, 4
+		BNE   $4, $0, loop
+)";
+
+// Directory for the files the checks write, removed once they finish.
+static filesystem::path scratchDir;
+
+// Plain run of a single configuration, which every other way is compared with. Its errors are returned in errors if
+// it is not null, and printed otherwise.
+static runner::result runPlain(string_view source, const runner::settings &set, string &out, string *errors = nullptr)
+{
+	ostringstream outStream, err;
+	runner::result res = runner::runSource(source, set, outStream, err);
+
+	if (errors != nullptr) *errors = err.str();
+	else if (!res.ok) cerr << err.str();
+
+	out = outStream.str();
+	return res;
+}
+
+static string readFile(const filesystem::path &path)
+{
+	ifstream in(path);
+	return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+// Sources in the examples directory, sorted by name.
+static vector<filesystem::path> examplePaths()
+{
+	vector<filesystem::path> examples;
+	for (const filesystem::directory_entry &entry : filesystem::directory_iterator(EXAMPLES_DIR)) {
+		if (entry.path().extension() == ".asm") examples.push_back(entry.path());
+	}
+
+	sort(examples.begin(), examples.end());
+	return examples;
+}
+
+static runner::settings plainSettings()
+{
+	runner::settings set;
+	set.statsOnly = true;
+	set.instrLimit = 1000000;
+	return set;
+}
+
+// Prints the values that differ and returns false if they do.
+template <typename T> static bool expectEqual(const T &actual, const T &expected, string_view what)
+{
+	if (actual == expected) return true;
+
+	cerr << what << ": " << actual << " instead of " << expected << endl;
+	return false;
+}
+
+// Same as expectEqual, for texts of several lines, printing only the first line that differs.
+static bool expectSameText(const string &actual, const string &expected, const string &what)
+{
+	if (actual == expected) return true;
+
+	istringstream actualLines(actual), expectedLines(expected);
+	string actualLine, expectedLine;
+
+	for (uint line = 1;; line++) {
+		bool actualEnd = !getline(actualLines, actualLine), expectedEnd = !getline(expectedLines, expectedLine);
+
+		if (actualEnd || expectedEnd || actualLine != expectedLine) {
+			cerr << what << ", line " << line << ":\n" << (actualEnd ? "(end)" : actualLine) << "\ninstead of\n"
+				 << (expectedEnd ? "(end)" : expectedLine) << endl;
+			return false;
+		}
+	}
+}
+
+// Same as expectEqual, for values that are trivially copyable and have no padding.
+template <typename T> static bool expectSameBytes(const T &actual, const T &expected, const string &what)
+{
+	if (memcmp(&actual, &expected, sizeof(T)) == 0) return true;
+
+	cerr << what << " is different" << endl;
+	return false;
+}
+
+// Loads the source with the front end of flex and bison and with the one that tokenizes it in place, and checks that
+// both give the same program, or the same errors.
+static bool compareFrontEnds(string_view source, const string &name)
+{
+	simulator::program parsed, mapped;
+	ostringstream parsedErr, mappedErr;
+
+	istringstream in{string(source)};
+	bool parsedOk = translator::loadProgram(in, parsed, parsedErr);
+	bool mappedOk = translator::loadProgram(source, mapped, mappedErr);
+
+	if (!expectEqual(mappedOk, parsedOk, name + " loaded") ||
+		!expectEqual(mappedErr.str(), parsedErr.str(), name + " errors"))
+		return false;
+
+	if (!parsedOk) return true;
+
+	bool ok = expectEqual(mapped.code.size(), parsed.code.size(), name + " instructions") &&
+			  expectEqual(mapped.codeText.size(), parsed.codeText.size(), name + " texts");
+
+	for (uint i = 0; ok && i < parsed.code.size(); i++) {
+		const simulator::instruction &text = mapped.codeText[i], &parsedText = parsed.codeText[i];
+		string what = name + " instruction " + to_string(i);
+
+		// The decoded part of the texts leaves the fields that are not used undefined, but the code has all of them.
+		ok &= expectSameBytes(mapped.code[i], parsed.code[i], what) &&
+			  expectEqual(text.label, parsedText.label, what + " label") &&
+			  expectEqual(text.displayName, parsedText.displayName, what + " name") &&
+			  expectEqual(text.labelOp, parsedText.labelOp, what + " label operand");
+	}
+
+	return ok && expectSameBytes(mapped.regs, parsed.regs, name + " registers") &&
+		   expectEqual(mapped.dataMem == parsed.dataMem, true, name + " memory is the same");
+}
+
+// The examples, the programs of the other checks and some wrong ones, with both front ends.
+static bool checkFrontEnds()
+{
+	vector<filesystem::path> examples = examplePaths();
+	bool ok = expectEqual(examples.empty(), false, "No examples in " EXAMPLES_DIR);
+
+	for (const filesystem::path &path : examples)
+		ok &= compareFrontEnds(readFile(path), path.filename().string());
+
+	const pair<string_view, const char *> sources[] = {
+		{loopSource, "loop"},
+		{countSource, "count"},
+		{splitSource, "split"},
+		{loadFaultSource, "load fault"},
+		{storeFaultSource, "store fault"},
+		{"", "empty"},
+		{"ADDI $1, $0\n", "missing operand"},
+		{"ADD $1, $2, $3\nDEFW $4, 1\n", "variable after the code"},
+		{"L: ADD $1, $2, $3\nL: ADD $1, $2, $3\n", "repeated label"},
+		{"J NOWHERE\n", "unknown label"},
+		{"ADD $1, $2, $40\n", "wrong register"},
+		{"FOO $1, $2\n", "unknown instruction"},
+	};
+
+	for (auto [source, name] : sources)
+		ok &= compareFrontEnds(source, name);
+
+	return ok;
+}
+
+// Large generated programs with both front ends, so that the parser grows its arena and its vectors many times.
+static bool checkGeneratedFrontEnds()
+{
+	static const char *options[] = {"-s 20000", "-s 50000 -l 3 -i 4 -b 40 -r 0.3 -m 65536 -x 7",
+									"-s 10000 -l 4 -i 2 -d 1,0,0,4 -t 0.9 -x 3"};
+	bool ok = true;
+
+	for (uint i = 0; i < size(options); i++) {
+		filesystem::path path = scratchDir / ("generated" + to_string(i) + ".asm");
+		string command = string("\"" GENERATOR_PATH "\" ") + options[i] + " -o \"" + path.string() + '"';
+
+		if (system(command.c_str()) != 0) {
+			cerr << "Failed to run " << command << endl;
+			ok = false;
+			continue;
+		}
+
+		ok &= compareFrontEnds(readFile(path), options[i]);
+	}
+
+	return ok;
+}
+
+// Diagrams of the examples with every forwarding, static branch prediction and branch resolution phase, against the
+// files in the golden directory. Those were printed by mipspipeline with the options in the line before each diagram,
+// and have to be printed again with any change of the timing or of the diagrams that is meant.
+static bool checkGoldenDiagrams()
+{
+	static const pair<forwardingType, const char *> forwardings[] = {
+		{forwardingType::NONE, "no"}, {forwardingType::ALU, "alu"}, {forwardingType::FULL, "full"}};
+	static const pair<branchPredType, const char *> branchPreds[] = {
+		{branchPredType::NONE, "no"}, {branchPredType::TAKEN, "t"}, {branchPredType::NOT_TAKEN, "nt"}};
+
+	vector<filesystem::path> examples = examplePaths();
+	bool ok = expectEqual(examples.empty(), false, "No examples in " EXAMPLES_DIR);
+
+	for (const filesystem::path &path : examples) {
+		string source = readFile(path), diagrams;
+		runner::settings set;
+
+		for (auto [forwarding, forwardingName] : forwardings) {
+			for (auto [branchPred, branchPredName] : branchPreds) {
+				for (bool branchInDec : {false, true}) {
+					set.forwarding = forwarding;
+					set.branchPred = branchPred;
+					set.branchInDec = branchInDec;
+
+					string out;
+					runPlain(source, set, out);
+					diagrams += string("== --forwarding=") + forwardingName + " -b " + branchPredName +
+								(branchInDec ? " -d" : "") + '\n' + out;
+				}
+			}
+		}
+
+		filesystem::path golden = filesystem::path(GOLDEN_DIR) / path.filename().replace_extension(".txt");
+		ok &= expectSameText(diagrams, readFile(golden), golden.string());
+	}
+
+	return ok;
+}
+
+// Totals of a program without instructions, whose CPI is 0 instead of a division by zero.
+static bool checkEmptyProgram()
+{
+	runner::settings set = plainSettings();
+	string stats, diagram;
+
+	runPlain("", set, stats);
+	set.statsOnly = false;
+	runPlain("", set, diagram);
+
+	return expectEqual(stats, string("Instructions: 0\nStalls: 0\nCycles: 0\nAverage CPI: 0/0 = 0\n"), "Statistics") &
+		   expectEqual(diagram, string("\nCycles: 0\nAverage CPI: 0/0 = 0\n"), "Diagram");
+}
+
+// Every configuration of the sweep against a plain run of it.
+static bool checkSweep()
+{
+	simulator::program prog;
+	if (!translator::loadProgram(loopSource, prog, cerr)) return false;
+
+	runner::settings set = plainSettings();
+	simulator::interpreter interp(prog.code, prog.dataMem, prog.regs, set.dispatch);
+	vector<simulator::sweepResult> results;
+
+	if (!simulator::sweep(prog.code, interp, 0, set.instrLimit, 0, set.predictor, results)) {
+		cerr << "The sweep reached the limit." << endl;
+		return false;
+	}
+
+	bool ok = true;
+
+	for (const simulator::sweepResult &result : results) {
+		set.forwarding = result.forwarding;
+		set.branchPred = result.branchPred;
+		set.branchInDec = result.branchInDec;
+
+		string out;
+		runner::result plain = runPlain(loopSource, set, out);
+
+		string what = "Configuration " + to_string((int)result.forwarding) + '/' + to_string((int)result.branchPred) +
+					  '/' + to_string(result.branchInDec);
+		ok &= plain.ok && expectEqual(result.instrCnt, plain.instrCnt, what + " instructions") &&
+			  expectEqual(result.cycles, plain.cycles, what + " cycles");
+	}
+
+	return ok;
+}
+
+// The output of every file of a batch, including one that does not assemble, against a plain run of it.
+static bool checkBatch()
+{
+	const string_view sources[] = {loopSource, countSource, "ADDI $1, $0\n"};
+	vector<string> files;
+
+	for (uint i = 0; i < size(sources); i++) {
+		files.push_back((scratchDir / ("batch" + to_string(i) + ".asm")).string());
+		ofstream(files.back()) << sources[i];
+	}
+
+	runner::settings set = plainSettings();
+	set.mapInput = true;
+	set.forwarding = forwardingType::FULL;
+	set.branchPred = branchPredType::TWO_BIT;
+
+	ostringstream summary;
+	bool batchOk = runner::runBatch(files, scratchDir.string(), set, summary);
+	bool ok = expectEqual(batchOk, false, "Batch with a wrong file succeeded");
+
+	for (uint i = 0; i < size(sources); i++) {
+		string out, err;
+		runner::result plain = runPlain(sources[i], set, out, &err);
+
+		string batchOut = readFile(filesystem::path(files[i]).replace_extension(".out"));
+		ok &= expectEqual(batchOut, out + err, "Output of " + files[i]);
+		ok &= expectEqual(plain.ok, i < 2, "Result of " + files[i]);
+	}
+
+	return ok;
+}
+
+// A single window that covers the whole program measures all of it from an empty pipeline, as a plain run does, so
+// the estimate is exact.
+static bool checkSampler()
+{
+	bool ok = true;
+
+	for (branchPredType branchPred : {branchPredType::NONE, branchPredType::NOT_TAKEN, branchPredType::GSHARE}) {
+		runner::settings set = plainSettings();
+		set.forwarding = forwardingType::FULL;
+		set.branchPred = branchPred;
+
+		string out;
+		runner::result plain = runPlain(loopSource, set, out);
+
+		set.samplePeriod = set.instrLimit;
+		set.sampleWindow = set.instrLimit;
+		set.sampleWarmup = 0;
+		runner::result sampled = runPlain(loopSource, set, out);
+
+		string what = "Prediction " + to_string((int)branchPred);
+		ok &= plain.ok && sampled.ok && expectEqual(sampled.instrCnt, plain.instrCnt, what + " instructions") &&
+			  expectEqual(sampled.cycles, plain.cycles, what + " cycles");
+	}
+
+	return ok;
+}
+
+// Tracing does not change the output of a plain run, and the trace has a record for every instruction and stall of it.
+static bool checkTrace()
+{
+	runner::settings set = plainSettings();
+	set.forwarding = forwardingType::ALU;
+	set.branchPred = branchPredType::TWO_BIT;
+	set.cache.size = 512;
+
+	string out, tracedOut;
+	runner::result plain = runPlain(loopSource, set, out);
+
+	set.tracePath = (scratchDir / "loop.trace").string();
+	runner::result traced = runPlain(loopSource, set, tracedOut);
+	if (!plain.ok || !traced.ok) return false;
+
+	parser::mappedFile mapped;
+	if (!mapped.open(set.tracePath)) {
+		cerr << "The trace was not written." << endl;
+		return false;
+	}
+
+	string_view file = mapped.text();
+	renderer::traceHeader header = {};
+	if (file.size() >= sizeof(header)) memcpy(&header, file.data(), sizeof(header));
+	header.convert();
+
+	if (file.size() < sizeof(header) || header.recordOffset + header.recordCnt * sizeof(renderer::traceRecord) >
+											 file.size()) {
+		cerr << "The trace is truncated." << endl;
+		return false;
+	}
+
+	uint64_t instrCnt = 0, stallCnt = 0, lastExecute = 0;
+
+	for (uint64_t i = 0; i < header.recordCnt; i++) {
+		renderer::traceRecord record;
+		memcpy(&record, file.data() + header.recordOffset + i * sizeof(record), sizeof(record));
+		record.convert();
+
+		if (record.kind == renderer::traceKind::STALL) {
+			stallCnt++;
+		} else {
+			instrCnt++;
+			lastExecute = record.execute;
+		}
+	}
+
+	// Every cycle from the one in which the first instruction enters the execution phase, which is cycle 2, to the one
+	// in which the last does, 3 cycles before the end, has either an instruction or a stall.
+	uint64_t stalls = plain.cycles - 4 - plain.instrCnt;
+
+	return expectEqual(tracedOut, out, "Output") &&
+		   expectEqual(header.instrCnt, (uint64_t)plain.instrCnt, "Instructions in the header") &&
+		   expectEqual(header.cycles, (uint64_t)plain.cycles, "Cycles in the header") &&
+		   expectEqual(instrCnt, (uint64_t)plain.instrCnt, "Instruction records") &&
+		   expectEqual(stallCnt, stalls, "Stall records") &&
+		   expectEqual(lastExecute + 3, (uint64_t)plain.cycles, "Cycles after the last record");
+}
+
+// Restoring a checkpoint from the middle of a run, with the tables of the predictor and the cache, gives the same
+// output as not stopping it. Saving them does not change the run either.
+static bool checkCheckpoint()
+{
+	runner::settings configs[3] = {plainSettings(), plainSettings(), plainSettings()};
+
+	configs[0].forwarding = forwardingType::FULL;
+	configs[0].branchPred = branchPredType::GSHARE;
+	configs[0].predictor.btbSize = 16;
+	configs[0].cache.size = 512;
+
+	configs[1].branchPred = branchPredType::TWO_BIT;
+	configs[1].cache = {.size = 256, .lineSize = 16, .ways = 4, .replacement = simulator::replacementType::RANDOM};
+
+	configs[2].forwarding = forwardingType::ALU;
+	configs[2].branchPred = branchPredType::ONE_BIT;
+	configs[2].cache = {.size = 1024, .ways = 2, .replacement = simulator::replacementType::FIFO,
+						.write = simulator::writePolicy::THROUGH};
+
+	bool ok = true;
+
+	for (uint i = 0; i < size(configs); i++) {
+		runner::settings &set = configs[i];
+		string out, savedOut, restoredOut;
+		runner::result plain = runPlain(loopSource, set, out);
+
+		set.checkpointPath = (scratchDir / "loop.checkpoint").string();
+		set.checkpointEvery = plain.cycles / 2 + 1; // A single checkpoint, in the middle of the run.
+		runner::result saved = runPlain(loopSource, set, savedOut);
+
+		set.restorePath = set.checkpointPath;
+		set.checkpointPath.clear();
+		runner::result restored = runPlain(loopSource, set, restoredOut);
+
+		string what = "Configuration " + to_string(i);
+		ok &= plain.ok && saved.ok && restored.ok && expectEqual(savedOut, out, what + " output when saving") &&
+			  expectEqual(restoredOut, out, what + " output when restoring") &&
+			  expectEqual(restored.instrCnt, plain.instrCnt, what + " instructions") &&
+			  expectEqual(restored.cycles, plain.cycles, what + " cycles");
+	}
+
+	return ok;
+}
+
+// Accesses split between pages, with every dispatch and with both kinds of memory, against a plain run.
+static bool checkSplitAccesses()
+{
+	runner::settings set = plainSettings();
+	string out;
+	runner::result plain = runPlain(splitSource, set, out);
+	bool ok = plain.ok && expectEqual(plain.instrCnt, splitInstrCnt, "Instructions of a plain run");
+
+	for (simulator::dispatchType dispatch :
+		 {simulator::dispatchType::SWITCH, simulator::dispatchType::THREADED, simulator::dispatchType::BLOCK}) {
+		for (bool mapMemory : {false, true}) {
+			set.dispatch = dispatch;
+			set.mapMemory = mapMemory;
+
+			string splitOut;
+			runner::result split = runPlain(splitSource, set, splitOut);
+
+			string what = "Dispatch " + to_string((int)dispatch) + (mapMemory ? " mapped" : " paged");
+			ok &= split.ok && expectEqual(splitOut, out, what + " output");
+		}
+	}
+
+	return ok;
+}
+
+// A mapped memory, with every dispatch, against a plain run, which uses a paged one. Going outside of it is reported
+// with the instruction that did it.
+static bool checkMappedMemory()
+{
+	static const simulator::dispatchType dispatches[] = {
+		simulator::dispatchType::SWITCH, simulator::dispatchType::THREADED, simulator::dispatchType::BLOCK};
+
+	runner::settings set = plainSettings();
+	set.forwarding = forwardingType::FULL;
+	set.branchPred = branchPredType::TAKEN;
+
+	string out;
+	runner::result plain = runPlain(loopSource, set, out);
+	bool ok = plain.ok;
+
+	set.mapMemory = true;
+
+	for (simulator::dispatchType dispatch : dispatches) {
+		set.dispatch = dispatch;
+
+		string mappedOut;
+		runner::result mapped = runPlain(loopSource, set, mappedOut);
+		ok &= mapped.ok && expectEqual(mappedOut, out, "Dispatch " + to_string((int)dispatch) + " output");
+	}
+
+	// The memory is rounded up to whole pages that fit the variables, two for the load and one for the store.
+	set.memorySize = 4096;
+
+	const struct {
+		string_view source;
+		string_view error;
+	} faults[] = {{loadFaultSource, "Error: Address 8192 is outside of the 8192 bytes of memory, accessed by "
+									"instruction 3 (LW).\n"},
+				  {storeFaultSource, "Error: Address 4097 is outside of the 4096 bytes of memory, accessed by "
+									 "instruction 2 (SB).\n"}};
+
+	for (const auto &fault : faults) {
+		for (simulator::dispatchType dispatch : dispatches) {
+			set.dispatch = dispatch;
+
+			string faultOut, error;
+			runner::result faulted = runPlain(fault.source, set, faultOut, &error);
+			ok &= expectEqual(faulted.ok, false, "Run that faulted") &&
+				  expectEqual(error, string(fault.error), "Dispatch " + to_string((int)dispatch) + " error");
+		}
+	}
+
+	return ok;
+}
+
+// Every core, with barriers often and rarely, on one thread and several, with both kinds of memory, against a plain
+// run. Each core works on its own part of the memory, so it behaves like a single one.
+static bool checkCores()
+{
+	runner::settings set = plainSettings();
+	set.forwarding = forwardingType::FULL;
+	set.branchPred = branchPredType::TWO_BIT;
+
+	string out;
+	runner::result plain = runPlain(loopSource, set, out);
+	bool ok = plain.ok;
+
+	simulator::coreConfig config = {.cores = 4,
+									.forwarding = set.forwarding,
+									.branchPred = set.branchPred,
+									.branchInDec = set.branchInDec,
+									.predictor = set.predictor,
+									.dispatch = set.dispatch};
+
+	for (uint quantum : {100u, 10000u}) {
+		for (uint threads : {1u, 4u}) {
+			for (bool mapMemory : {false, true}) {
+				simulator::program prog;
+				if (!translator::loadProgram(loopSource, prog, cerr)) return false;
+				if (mapMemory && !prog.dataMem.map(0)) return false;
+
+				config.quantum = quantum;
+				vector<simulator::coreResult> results;
+				ok &= simulator::simulateCores(prog, config, set.instrLimit, threads, results);
+
+				string what = "Quantum " + to_string(quantum) + ", " + to_string(threads) + " threads" +
+							  (mapMemory ? ", mapped" : ", paged");
+				ok &= expectEqual(results.size(), (size_t)config.cores, what + " cores");
+
+				for (uint core = 0; core < results.size(); core++) {
+					string coreWhat = what + ", core " + to_string(core);
+					ok &= expectEqual(results[core].limitReached, false, coreWhat + " reached the limit") &&
+						  expectEqual(results[core].instrCnt, plain.instrCnt, coreWhat + " instructions") &&
+						  expectEqual(results[core].cycles, plain.cycles, coreWhat + " cycles");
+				}
+			}
+		}
+	}
+
+	return ok;
+}
+
+int main()
+{
+	static const struct {
+		const char *name;
+		bool (*run)();
+	} checks[] = {
+		{"front ends", checkFrontEnds},
+		{"generated front ends", checkGeneratedFrontEnds},
+		{"golden diagrams", checkGoldenDiagrams},
+		{"empty program", checkEmptyProgram},
+		{"sweep", checkSweep},
+		{"batch", checkBatch},
+		{"sampler", checkSampler},
+		{"trace", checkTrace},
+		{"checkpoint", checkCheckpoint},
+		{"split accesses", checkSplitAccesses},
+		{"mapped memory", checkMappedMemory},
+		{"cores", checkCores},
+	};
+
+	scratchDir = filesystem::temp_directory_path() / ("mipspipeline_regression_" + to_string(getpid()));
+	filesystem::create_directories(scratchDir);
+
+	uint failed = 0;
+
+	for (const auto &check : checks) {
+		bool ok = check.run();
+		cout << (ok ? "ok      " : "FAILED  ") << check.name << endl;
+		if (!ok) failed++;
+	}
+
+	filesystem::remove_all(scratchDir);
+
+	cout << "\nChecks: " << size(checks) << "\nFailed: " << failed << endl;
+	return failed == 0 ? 0 : 1;
+}